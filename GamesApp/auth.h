@@ -3,13 +3,20 @@
 
 #include <string>
 #include <iostream>
-#include <fstream>
+#include "metrics.h"
+#include "user_store.h"
 #include "utils.h"
 
 // Handles login/signup
 // Returns false if user exits
 inline bool authenticateUser(std::string& currentUser,
                              std::string& favoritesFile) {
+    // Indexed, so logins don't scan users.csv
+    UserStore users;
+    {
+        ScopedOp timed(OP_LOGIN);
+        users.open("users.csv");
+    }
     while (true) {
         std::cout << "Welcome! Type 1 to Login, 2 to Sign Up, or 0 to Exit: ";
         std::string option;
@@ -29,21 +36,20 @@ inline bool authenticateUser(std::string& currentUser,
             getline(std::cin, password);
             password = trim(password);
 
-            std::ifstream userCheck("users.csv");
-            std::string uline;
-            while (getline(userCheck, uline)) {
-                auto f = splitCSVLine(uline);
-                if (f.size() >= 2 && f[0] == name) {
-                    std::cout << "That username is already taken.\n";
-                    goto retry;
-                }
+            AddUserResult added = USER_TAKEN;
+            if (!name.empty()) {
+                ScopedOp timed(OP_LOGIN);
+                added = users.add(name, password);
             }
-
-            {
-                std::ofstream newUser("users.csv", std::ios::app);
-                newUser << name << "," << password << "\n";
+            if (name.empty()) {
+                std::cout << "Username can't be empty.\n";
+            } else if (added == USER_IO_ERROR) {
+                std::cout << "Couldn't save the account to users.csv, please try again.\n";
+            } else if (added == USER_TAKEN) {
+                std::cout << "That username is already taken.\n";
+            } else {
+                std::cout << "Sign up successful! Please log in.\n";
             }
-            std::cout << "Sign up successful! Please log in.\n";
         }
         else if (option == "1") {  // Login
             std::cout << "Login - enter your username: ";
@@ -56,24 +62,22 @@ inline bool authenticateUser(std::string& currentUser,
             getline(std::cin, password);
             password = trim(password);
 
-            std::ifstream userFile("users.csv");
-            std::string uline;
-            while (getline(userFile, uline)) {
-                auto f = splitCSVLine(uline);
-                if (f.size() >= 2 && f[0] == name && f[1] == password) {
-                    currentUser = name;
-                    favoritesFile = "favorites_" + name + ".csv";
-                    std::cout << "Welcome, " << name << "!\n";
-                    return true;
-                }
+            bool ok;
+            {
+                ScopedOp timed(OP_LOGIN);
+                ok = users.checkPassword(name, password);
+            }
+            if (ok) {
+                currentUser = name;
+                favoritesFile = "favorites_" + name + ".csv";
+                std::cout << "Welcome, " << name << "!\n";
+                return true;
             }
             std::cout << "Incorrect username or password.\n";
         }
         else {
             std::cout << "Invalid option.\n";
         }
-
-    retry:;
     }
 }
 
@@ -0,0 +1,219 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "bm25.h"
+#include "filter.h"
+#include "game_table.h"
+#include "metrics.h"
+#include "name_index.h"
+#include "rating_index.h"
+#include "result_writer.h"
+#include "top.h"
+#include "utils.h"
+
+// Runs queries from a script instead of the menu, one command per line:
+//   search <text>          names containing text, file order
+//   fuzzy <k> <text>       names within k typos of containing text, closest first
+//   best <n> <words>       the n names that best match the words, BM25 plus
+//                          popularity, best first (see bm25.h)
+//   rating>=<x>            also rating<=<x>, rating=<lo>-<hi>; best first
+//   top <keys> <n> [asc|desc]  leaderboard, e.g. top likes 20, top rating:desc,visits:asc 10
+//                          (keys are columns or "ratio"; see top.h)
+//   filter <expression>    e.g. filter rating >= 90 and name ~ "tycoon" (see filter.h)
+//   stats                  operation timings so far, as "metric" lines in the log
+//                          (needs --metrics; they are also dumped at the end)
+// Blank lines and lines starting with '#' are skipped.
+//
+// Results go to `out` as CSV: a header, then each matching row prefixed
+// with the number of the query that produced it. Timings go to `log` as
+// CSV too, one "timing" line per query and a "summary" line at the end,
+// so a run can be diffed or fed to a spreadsheet. Cells the loader
+// couldn't parse show up first as "warning" lines (query 0).
+class BatchRunner {
+public:
+    BatchRunner(const GameTable& t, const NameIndex& n, const RatingIndex& r, const TopIndex& top,
+                const RelevanceIndex& rel)
+        : table(t), names(n), ratings(r), tops(top), relevance(rel) {}
+
+    // Returns the number of commands that failed
+    size_t run(std::istream& in, std::ostream& out, std::ostream& log) {
+        ResultWriter writer(out);
+        writer.put("query,Rank,Name,Active,Visits,Favourites,Likes,Dislikes,Rating\n");
+        log << "kind,query,rows,micros,command\n";
+        if (!table.issues.empty()) {
+            log << "warning,0,0,0," << quote(table.issues.summary()) << "\n";
+            for (const std::string& e : table.issues.examples) log << "warning,0,0,0," << quote(e) << "\n";
+        }
+
+        std::vector<double> micros;
+        size_t failed = 0, totalRows = 0, id = 0;
+        std::string line, error;
+        std::vector<size_t> rows;
+        auto started = std::chrono::steady_clock::now();
+        while (std::getline(in, line)) {
+            std::string cmd = trim(line);
+            if (cmd.empty() || cmd[0] == '#') continue;
+            if (toLower(cmd) == "stats") {
+                metrics::printLines(log);
+                continue;
+            }
+            ++id;
+
+            auto t0 = std::chrono::steady_clock::now();
+            bool ok = execute(cmd, rows, error);
+            auto t1 = std::chrono::steady_clock::now();
+            micros.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+
+            if (!ok) {
+                ++failed;
+                log << "error," << id << ",0," << formatMicros(micros.back()) << ","
+                    << quote(cmd + ": " + error) << "\n";
+                continue;
+            }
+            std::string prefix = std::to_string(id) + ",";
+            for (size_t row : rows) {
+                writer.put(prefix);
+                writer.putRow(table, row);
+            }
+            totalRows += rows.size();
+            log << "timing," << id << "," << rows.size() << "," << formatMicros(micros.back()) << ","
+                << quote(cmd) << "\n";
+        }
+        writer.flush();
+        double wall = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+
+        // Aggregate over query execution only; wall time also includes output
+        double sum = 0;
+        for (double m : micros) sum += m;
+        std::sort(micros.begin(), micros.end());
+        log << "summary,queries=" << id << ",failed=" << failed << ",rows=" << totalRows
+            << ",total_us=" << formatMicros(sum)
+            << ",mean_us=" << formatMicros(micros.empty() ? 0 : sum / (double)micros.size())
+            << ",p50_us=" << formatMicros(percentile(micros, 0.50))
+            << ",p99_us=" << formatMicros(percentile(micros, 0.99))
+            << ",max_us=" << formatMicros(micros.empty() ? 0 : micros.back())
+            << ",wall_us=" << formatMicros(wall)
+            << ",qps=" << formatMicros(sum > 0 ? (double)id * 1e6 / sum : 0) << "\n";
+        metrics::printLines(log);
+        log.flush();
+        return failed;
+    }
+
+    // Run one command. On failure returns false and says why in error.
+    bool execute(const std::string& cmd, std::vector<size_t>& rows, std::string& error) const {
+        rows.clear();
+        std::string lower = toLower(cmd);
+        if (lower.rfind("search ", 0) == 0) {
+            ScopedOp timed(OP_SEARCH);
+            rows = names.search(trim(cmd.substr(7)));
+            return true;
+        }
+        if (lower.rfind("fuzzy ", 0) == 0) {
+            int k = 0, used = 0;
+            if (std::sscanf(cmd.c_str() + 6, "%d %n", &k, &used) < 1 || used == 0 || k < 0) {
+                error = "expected fuzzy <k> <text>";
+                return false;
+            }
+            ScopedOp timed(OP_SEARCH);
+            for (const auto& m : names.fuzzySearch(trim(cmd.substr(6 + (size_t)used)), k)) rows.push_back(m.row);
+            return true;
+        }
+        if (lower.rfind("best ", 0) == 0) {
+            int n = 0, used = 0;
+            if (std::sscanf(cmd.c_str() + 5, "%d %n", &n, &used) < 1 || used == 0 || n <= 0) {
+                error = "expected best <n> <words>";
+                return false;
+            }
+            ScopedOp timed(OP_SEARCH);
+            for (const auto& m : relevance.search(trim(cmd.substr(5 + (size_t)used)), (size_t)n)) rows.push_back(m.row);
+            return true;
+        }
+        if (lower.rfind("filter ", 0) == 0) {
+            ScopedOp timed(OP_FILTER);
+            FilterExpr filter;
+            if (!filter.compile(cmd.substr(7), table, names, error)) return false;
+            rows = filter.run();
+            return true;
+        }
+        if (lower.rfind("rating", 0) == 0) {
+            ScopedOp timed(OP_RATING);
+            return rating(trim(lower.substr(6)), rows, error);
+        }
+        if (lower.rfind("top ", 0) == 0) {
+            ScopedOp timed(OP_TOP);
+            return top(lower.substr(4), rows, error);
+        }
+        error = "unknown command";
+        return false;
+    }
+
+private:
+    const GameTable& table;
+    const NameIndex& names;
+    const RatingIndex& ratings;
+    const TopIndex& tops;
+    const RelevanceIndex& relevance;
+
+    bool rating(const std::string& expr, std::vector<size_t>& rows, std::string& error) const {
+        float lo = -INFINITY, hi = INFINITY;
+        char* end = nullptr;
+        if (expr.rfind(">=", 0) == 0) {
+            lo = std::strtof(expr.c_str() + 2, &end);
+        } else if (expr.rfind("<=", 0) == 0) {
+            hi = std::strtof(expr.c_str() + 2, &end);
+        } else if (expr.rfind("=", 0) == 0) {
+            if (std::sscanf(expr.c_str() + 1, "%f-%f", &lo, &hi) != 2) {
+                error = "expected rating=<lo>-<hi>";
+                return false;
+            }
+            end = nullptr;
+        } else {
+            error = "expected rating>=<x>, rating<=<x> or rating=<lo>-<hi>";
+            return false;
+        }
+        if (end && (end == expr.c_str() + 2 || !trim(end).empty())) {
+            error = "bad number";
+            return false;
+        }
+        RatingIndex::Slice slice = ratings.between(lo, hi);
+        rows.assign(slice.size(), 0);
+        std::reverse_copy(slice.begin(), slice.end(), rows.begin());
+        return true;
+    }
+
+    bool top(const std::string& args, std::vector<size_t>& rows, std::string& error) const {
+        std::vector<TopIndex::Key> keys;
+        size_t n = 0;
+        if (!TopIndex::parseQuery(args, keys, n, error)) return false;
+        rows = tops.top(table, keys, n);
+        return true;
+    }
+
+    static double percentile(const std::vector<double>& sorted, double q) {
+        if (sorted.empty()) return 0;
+        return sorted[(size_t)std::llround(q * (double)(sorted.size() - 1))];
+    }
+
+    static std::string formatMicros(double v) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.1f", v);
+        return buf;
+    }
+
+    static std::string quote(const std::string& s) {
+        std::string out = "\"";
+        for (char c : s) { if (c == '"') out += '"'; out += c; }
+        return out + "\"";
+    }
+};
+
+#endif
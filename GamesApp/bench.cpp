@@ -0,0 +1,733 @@
+// Microbenchmarks for the GamesApp load path, and a scaling run over
+// synthetic datasets.
+// Build: g++ -std=c++17 -O2 -march=native -pthread bench.cpp -o bench
+// Usage: ./bench csv [file] [copies]
+//        ./bench counts [file] [copies]
+//        ./bench gen <rows> <out.csv> [seed]
+//        ./bench scale [dir] [rows...]     default 10K, 100K, 1M, 10M rows
+//        ./bench check [counts|bm25|history] [file]   correctness checks, no timings
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "bm25.h"
+#include "count_parse.h"
+#include "csv.h"
+#include "dataset.h"
+#include "favorites.h"
+#include "history.h"
+#include "mapped_file.h"
+#include "synth.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BENCH_HAVE_FORK 1
+#endif
+
+using namespace std;
+
+// The original char-at-a-time splitter, kept here as the baseline
+static vector<string> legacySplitCSVLine(const string& line) {
+    vector<string> cols;
+    string cur;
+    bool inQuotes = false;
+    for (char c : line) {
+        if (c == '"') { inQuotes = !inQuotes; continue; }
+        if (c == ',' && !inQuotes) { cols.push_back(cur); cur.clear(); }
+        else cur.push_back(c);
+    }
+    cols.push_back(cur);
+    return cols;
+}
+
+template <class F>
+static void timeIt(const string& label, size_t bytes, F&& body) {
+    auto start = chrono::steady_clock::now();
+    size_t fields = body();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << label << ": " << fields << " fields in " << secs * 1000 << " ms, "
+         << (bytes / secs) / (1024 * 1024) << " MB/s\n";
+}
+
+static int benchCSV(const string& path, size_t copies) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cerr << "Can't open " << path << "\n";
+        return 1;
+    }
+    // Repeat the data rows so the timings aren't lost in noise
+    string_view src = file.view();
+    size_t firstNewline = src.find('\n');
+    string data(src);
+    string_view rows = src.substr(firstNewline + 1);
+    for (size_t i = 1; i < copies; ++i) data.append(rows);
+    cout << "Input: " << data.size() / (1024 * 1024) << " MB (" << copies << " copies)\n";
+
+    timeIt("legacy splitCSVLine", data.size(), [&] {
+        istringstream in(data);
+        string line;
+        size_t n = 0;
+        while (getline(in, line)) n += legacySplitCSVLine(line).size();
+        return n;
+    });
+    timeIt("scalar readCSVField", data.size(), [&] {
+        size_t n = 0, pos = 0;
+        CsvField f;
+        bool eor;
+        while (pos < data.size()) { pos = readCSVField(data, pos, f, eor); ++n; }
+        return n;
+    });
+    timeIt("CsvScanner", data.size(), [&] {
+        CsvScanner scanner(data);
+        vector<CsvField> f;
+        size_t n = 0;
+        while (scanner.nextRecord(f)) n += f.size();
+        return n;
+    });
+    timeIt("findCSVDelimiters only", data.size(), [&] {
+        // Delimiter offsets alone, 64K at a time
+        const size_t window = 64 * 1024;
+        vector<uint32_t> out(window);
+        bool inQuotes = false;
+        size_t n = 0;
+        for (size_t pos = 0; pos < data.size(); pos += window)
+            n += findCSVDelimiters(data.data() + pos, min(window, data.size() - pos), inQuotes, out.data());
+        return n;
+    });
+    return 0;
+}
+
+// The original byte-at-a-time count parser, kept as the baseline
+static bool legacyParseCount(string_view s, int64_t& out) {
+    out = 0;
+    bool any = false;
+    for (char c : s) {
+        if (c >= '0' && c <= '9') {
+            out = out * 10 + (c - '0');
+            any = true;
+        } else if (c != ',' && c != ' ') {
+            out = 0;
+            return false;
+        }
+    }
+    return any;
+}
+
+// What main.cpp did before the table was typed: strip commas, then stod
+static bool stodParseCount(string_view s, int64_t& out) {
+    string digits;
+    for (char c : s) if (c != ',') digits += c;
+    try { out = (int64_t)stod(digits); return true; } catch (...) { out = 0; return false; }
+}
+
+static int benchCounts(const string& path, size_t copies) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cerr << "Can't open " << path << "\n";
+        return 1;
+    }
+    // Every count cell in the file, repeated, as views into one buffer
+    vector<string_view> cells;
+    {
+        CsvScanner scanner(file.view(), skipCSVRecord(file.view(), 0));
+        vector<CsvField> f;
+        while (scanner.nextRecord(f))
+            for (size_t c = 2; c < 7 && c < f.size(); ++c) cells.push_back(f[c].text);
+    }
+    size_t perCopy = cells.size();
+    for (size_t i = 1; i < copies; ++i) cells.insert(cells.end(), cells.begin(), cells.begin() + (ptrdiff_t)perCopy);
+    size_t bytes = 0;
+    for (string_view c : cells) bytes += c.size();
+    cout << "Input: " << cells.size() << " count cells, " << bytes / (1024 * 1024) << " MB (" << copies
+         << " copies)\n";
+
+    // Same answers as the baseline on the real cells, and sane on edge cases
+    size_t mismatches = 0;
+    for (size_t i = 0; i < perCopy; ++i) {
+        int64_t a, b;
+        bool okA = legacyParseCount(cells[i], a);
+        bool okB = readCount(cells[i], b) == COUNT_OK;
+        if (okA != okB || (okA && a != b)) ++mismatches;
+    }
+    mt19937_64 rng(42);
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t v = rng() >> (rng() % 64);
+        if (v > (uint64_t)INT64_MAX) v >>= 1;
+        string s = to_string(v), grouped;
+        for (size_t k = 0; k < s.size(); ++k) {
+            if (k && (s.size() - k) % 3 == 0) grouped += ',';
+            grouped += s[k];
+        }
+        int64_t out;
+        if (readCount(grouped, out) != COUNT_OK || (uint64_t)out != v || readCount(s, out) != COUNT_OK ||
+            (uint64_t)out != v)
+            ++mismatches;
+    }
+    struct Case { const char* text; CountStatus want; };
+    const Case cases[] = {
+        {"", COUNT_EMPTY}, {"  ", COUNT_EMPTY}, {"0", COUNT_OK}, {"1,234", COUNT_OK}, {"12,34", COUNT_OK},
+        {"1,2a4", COUNT_MALFORMED}, {"-5", COUNT_MALFORMED}, {"N/A", COUNT_MALFORMED}, {",", COUNT_MALFORMED},
+        {"9,223,372,036,854,775,807", COUNT_OK}, {"9,223,372,036,854,775,808", COUNT_OVERFLOW},
+        {"99999999999999999999", COUNT_OVERFLOW}, {"1 234", COUNT_OK},
+    };
+    for (const Case& c : cases) {
+        int64_t out;
+        if (readCount(c.text, out) != c.want) {
+            cerr << "readCount(\"" << c.text << "\") gave " << countStatusName(readCount(c.text, out)) << "\n";
+            ++mismatches;
+        }
+    }
+    cout << "Mismatches against baseline and edge cases: " << mismatches << "\n";
+
+    auto run = [&](const string& label, auto parse) {
+        timeIt(label, bytes, [&] {
+            int64_t sum = 0, v;
+            size_t ok = 0;
+            for (string_view c : cells) {
+                ok += parse(c, v) ? 1 : 0;
+                sum += v;
+            }
+            if (sum == 42) cout << "";   // keep the sum alive
+            return ok;
+        });
+    };
+    run("stod with try/catch", stodParseCount);
+    run("legacy parseCount", legacyParseCount);
+    run("readCount", [](string_view s, int64_t& v) { return readCount(s, v) == COUNT_OK; });
+    return mismatches ? 1 : 0;
+}
+
+static int benchGen(uint64_t rows, const string& path, uint64_t seed) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        cerr << "Can't write " << path << "\n";
+        return 1;
+    }
+    auto start = chrono::steady_clock::now();
+    SynthGames synth(seed);
+    bool ok = synth.write(out, rows);
+    ok = fclose(out) == 0 && ok;
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!ok) {
+        cerr << "Write to " << path << " failed\n";
+        return 1;
+    }
+    double mb = (double)filesystem::file_size(path) / (1024 * 1024);
+    cerr << rows << " rows, " << mb << " MB in " << secs << " s (" << mb / secs << " MB/s)\n";
+    return 0;
+}
+
+#ifdef BENCH_HAVE_FORK
+
+template <class F>
+static double millis(F&& body) {
+    auto start = chrono::steady_clock::now();
+    body();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// One size of the scaling run, in a child process so its peak RSS is
+// its own. Walks the same path as a session: load, search, filter by
+// rating, add favorites, exit. Writes one CSV fragment to `fd`.
+static void scaleChild(const string& csv, int fd) {
+    string snap = csv + ".snap", favs = csv + ".favorites";
+    remove(snap.c_str());
+    remove(favs.c_str());
+
+    shared_ptr<Dataset> data;
+    double cold = millis([&] { data = loadDataset(csv); });   // parse, index, write snapshot
+    if (!data) _exit(1);
+    data.reset();
+    double warm = millis([&] { data = loadDataset(csv); });   // from the snapshot
+    if (!data) _exit(1);
+
+    const char* queries[] = {"obby", "simulator", "pet", "dragon rp", "tycoon", "xyzzy"};
+    const size_t QUERIES = sizeof(queries) / sizeof(queries[0]);
+    size_t searchHits = 0;
+    double search = millis([&] {
+        for (const char* q : queries) searchHits += data->names.search(q).size();
+    });
+
+    size_t ratingHits = 0;
+    double rating = millis([&] {
+        // What the menu does: the slice, copied out as rows
+        auto slice = data->ratings.atLeast(90.0f);
+        vector<size_t> rows(slice.begin(), slice.end());
+        ratingHits = rows.size();
+    });
+
+    const size_t ADDS = 1000;
+    double favorites = 0, exitMs = 0;
+    {
+        auto store = make_unique<FavoritesStore>();
+        store->open(favs, data->table);
+        mt19937_64 rng(7);
+        favorites = millis([&] {
+            for (size_t k = 0; k < ADDS; ++k) store->add((size_t)(rng() % data->table.size()));
+        });
+        exitMs = millis([&] {
+            store.reset();
+            data.reset();
+        });
+    }
+    remove(favs.c_str());
+
+    char line[256];
+    int n = snprintf(line, sizeof(line), "%.1f,%.1f,%.1f,%zu,%.1f,%zu,%.2f,%.1f", cold, warm,
+                     search * 1000 / QUERIES, searchHits, rating * 1000, ratingHits, favorites * 1000 / ADDS, exitMs);
+    (void)!write(fd, line, (size_t)n);
+    _exit(0);
+}
+
+static int benchScale(const string& dir, const vector<uint64_t>& sizes) {
+    filesystem::create_directories(dir);
+    cout << "rows,csv_mb,load_ms,load_mb_s,snapshot_load_ms,search_us,search_hits,rating_us,rating_hits,"
+            "favorite_add_us,exit_ms,peak_rss_mb\n";
+    for (uint64_t rows : sizes) {
+        string csv = dir + "/synth_" + to_string(rows) + ".csv";
+        if (!filesystem::exists(csv) && benchGen(rows, csv, rows) != 0) return 1;
+        double mb = (double)filesystem::file_size(csv) / (1024 * 1024);
+
+        int pipeFd[2];
+        if (pipe(pipeFd) != 0) return 1;
+        pid_t pid = fork();
+        if (pid < 0) return 1;
+        if (pid == 0) {
+            close(pipeFd[0]);
+            scaleChild(csv, pipeFd[1]);
+        }
+        close(pipeFd[1]);
+        string result;
+        char buf[256];
+        ssize_t got;
+        while ((got = read(pipeFd[0], buf, sizeof(buf))) > 0) result.append(buf, (size_t)got);
+        close(pipeFd[0]);
+        int status = 0;
+        rusage usage{};
+        wait4(pid, &status, 0, &usage);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || result.empty()) {
+            cerr << "Run at " << rows << " rows failed\n";
+            return 1;
+        }
+#ifdef __APPLE__
+        double rssMb = (double)usage.ru_maxrss / (1024 * 1024);   // bytes there
+#else
+        double rssMb = (double)usage.ru_maxrss / 1024;            // KB on Linux
+#endif
+        // Throughput goes right after the cold load time it comes from
+        size_t comma = result.find(',');
+        double coldMs = stod(result.substr(0, comma));
+        printf("%llu,%.1f,%s,%.1f%s,%.1f\n", (unsigned long long)rows, mb, result.substr(0, comma).c_str(),
+               mb / (coldMs / 1000), result.substr(comma).c_str(), rssMb);
+        fflush(stdout);
+        remove((csv + ".snap").c_str());
+    }
+    return 0;
+}
+
+#endif
+
+// Correctness checks. Each compares a fast path against a slow, obvious
+// version of the same thing and returns how many cases disagreed.
+
+// What readCount should say, by brute force: trim, reject anything but
+// digits and separators, then std::stoll on the digits. `overflowToo` is
+// set when the digits alone would overflow; readCount may notice that
+// before it reaches the junk, so either answer is right then.
+static CountStatus referenceCount(string_view s, int64_t& out, bool& overflowToo) {
+    out = 0;
+    overflowToo = false;
+    while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\r')) s.remove_suffix(1);
+    if (s.empty()) return COUNT_EMPTY;
+    string digits;
+    bool junk = false;
+    for (char c : s) {
+        if (c >= '0' && c <= '9') digits += c;
+        else if (c != ',' && c != ' ') junk = true;
+    }
+    if (digits.empty()) return COUNT_MALFORMED;
+    int64_t v = 0;
+    try { v = stoll(digits); } catch (const out_of_range&) { overflowToo = true; }
+    if (junk) return COUNT_MALFORMED;
+    if (overflowToo) return COUNT_OVERFLOW;
+    out = v;
+    return COUNT_OK;
+}
+
+static size_t checkCounts() {
+    mt19937_64 rng(7);
+    // Digits weighted up; '/' and ':' sit either side of them in ASCII
+    const string alphabet = "0123456789012345678901234567890123456789,,,,,,  \r-x/:";
+    auto grouped = [&] {
+        uint64_t v = rng() >> (rng() % 64);
+        if (v > (uint64_t)INT64_MAX && rng() % 2) v >>= 1;   // some just past the top
+        string d = to_string(v), out;
+        for (size_t k = 0; k < d.size(); ++k) {
+            if (k && (d.size() - k) % 3 == 0) out += ',';
+            out += d[k];
+        }
+        return out;
+    };
+    size_t cases = 0, mismatches = 0;
+    auto check = [&](const string& cell) {
+        ++cases;
+        int64_t want, got;
+        bool overflowToo;
+        CountStatus a = referenceCount(cell, want, overflowToo);
+        CountStatus b = readCount(cell, got);
+        bool ok = a == b && want == got;
+        if (!ok && a == COUNT_MALFORMED && b == COUNT_OVERFLOW && overflowToo && got == 0) ok = true;
+        if (!ok && mismatches++ < 10)
+            cerr << "readCount(\"" << cell << "\") gave " << countStatusName(b) << " " << got << ", expected "
+                 << countStatusName(a) << " " << want << "\n";
+    };
+    for (int i = 0; i < 1000000; ++i) {
+        // Well-formed, then the same with one byte changed, added or dropped
+        string cell = grouped();
+        check(cell);
+        size_t at = rng() % (cell.size() + 1);
+        char c = alphabet[rng() % alphabet.size()];
+        switch (rng() % 3) {
+        case 0: if (at < cell.size()) cell[at] = c; break;
+        case 1: cell.insert(cell.begin() + (ptrdiff_t)at, c); break;
+        default: if (at < cell.size()) cell.erase(at, 1); break;
+        }
+        check(cell);
+        // Anything at all, up to 26 bytes
+        string junk(rng() % 27, ' ');
+        for (char& j : junk) j = alphabet[rng() % alphabet.size()];
+        check(junk);
+    }
+    cout << "counts: " << cases << " cells, " << mismatches << " mismatches\n";
+    return mismatches;
+}
+
+// Words the way RelevanceIndex splits them: runs of ASCII letters and digits
+static bool isNameWordByte(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z');
+}
+
+static vector<string> nameWords(string_view s) {
+    vector<string> out;
+    for (size_t i = 0; i < s.size();) {
+        while (i < s.size() && !isNameWordByte(s[i])) ++i;
+        size_t start = i;
+        while (i < s.size() && isNameWordByte(s[i])) ++i;
+        if (i > start) out.emplace_back(s.substr(start, i - start));
+    }
+    return out;
+}
+
+// RelevanceIndex::search against BM25 written out longhand: every listed
+// row is scored directly from its words, in doubles, and the whole list
+// is sorted. Queries are pieces of real names, often with the last word
+// cut short so it matches as a prefix.
+static size_t checkBm25(const GameTable& table) {
+    const double K1 = RelevanceIndex::K1, B = RelevanceIndex::B;
+    RelevanceIndex index;
+    index.build(table);
+
+    size_t rows = table.size(), docs = 0;
+    double totalLength = 0;
+    vector<vector<string>> words(rows);
+    map<string, size_t> df;   // sorted, so prefixes are contiguous
+    vector<size_t> listed;
+    for (size_t i = 0; i < rows; ++i) {
+        if (!table.listed(i)) continue;
+        listed.push_back(i);
+        words[i] = nameWords(table.foldedName(i));
+        totalLength += (double)words[i].size();
+        ++docs;
+        for (const string& w : set<string>(words[i].begin(), words[i].end())) ++df[w];
+    }
+    double avgLength = docs ? totalLength / (double)docs : 1.0;
+    if (listed.empty()) return 0;
+
+    // Popularity prior: log active and log visits, min-max scaled, 60/40
+    vector<double> logActive(rows), logVisits(rows), prior(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        logActive[i] = log1p((double)max<int64_t>(0, table.active[i]));
+        logVisits[i] = log1p((double)max<int64_t>(0, table.visits[i]));
+    }
+    auto [loA, hiA] = minmax_element(logActive.begin(), logActive.end());
+    auto [loV, hiV] = minmax_element(logVisits.begin(), logVisits.end());
+    for (size_t i = 0; i < rows; ++i) {
+        double a = *hiA > *loA ? (logActive[i] - *loA) / (*hiA - *loA) : 0;
+        double v = *hiV > *loV ? (logVisits[i] - *loV) / (*hiV - *loV) : 0;
+        prior[i] = RelevanceIndex::PRIOR_WEIGHT * (0.6 * a + 0.4 * v);
+    }
+
+    auto naive = [&](const string& query) {
+        string q = foldCase(query);
+        vector<string> qw = nameWords(q);
+        bool lastIsPrefix = !q.empty() && isNameWordByte(q.back());
+        set<string> terms;
+        for (size_t w = 0; w < qw.size(); ++w) {
+            if (w + 1 == qw.size() && lastIsPrefix) {
+                // The word itself, then the most common of the first
+                // MAX_PREFIX_WALK words it starts, alphabetical on ties
+                vector<pair<size_t, string>> range;
+                for (auto it = df.lower_bound(qw[w]); it != df.end() && it->first.compare(0, qw[w].size(), qw[w]) == 0 &&
+                                                      range.size() < RelevanceIndex::MAX_PREFIX_WALK;
+                     ++it)
+                    range.push_back({it->second, it->first});
+                if (df.count(qw[w])) terms.insert(qw[w]);
+                stable_sort(range.begin(), range.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+                for (size_t i = 0; i < range.size() && i < RelevanceIndex::MAX_PREFIX_TERMS; ++i)
+                    terms.insert(range[i].second);
+            } else if (df.count(qw[w])) {
+                terms.insert(qw[w]);
+            }
+        }
+        vector<pair<double, size_t>> scored;
+        for (size_t i : listed) {
+            double score = 0;
+            bool any = false;
+            for (const string& t : terms) {
+                double tf = (double)count(words[i].begin(), words[i].end(), t);
+                if (tf == 0) continue;
+                any = true;
+                double n = (double)df[t];
+                double idf = log(1.0 + ((double)docs - n + 0.5) / (n + 0.5));
+                score += idf * tf * (K1 + 1) / (tf + K1 * (1 - B + B * (double)words[i].size() / avgLength));
+            }
+            if (any) scored.push_back({score + prior[i], i});
+        }
+        sort(scored.begin(), scored.end(), [](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        return scored;
+    };
+
+    mt19937_64 rng(11);
+    vector<string> queries = {"blox fru", "simulator", "simulator ", "sim", "a", "s", "tycoon obby", "zzzzqqq", "",
+                              "  "};
+    size_t random = rows > 100000 ? 50 : 2000;   // the naive side scans every row
+    for (size_t n = 0; n < random; ++n) {
+        vector<string> w = nameWords(table.name(listed[rng() % listed.size()]));
+        if (w.empty()) continue;
+        size_t from = rng() % w.size(), len = 1 + rng() % min<size_t>(3, w.size() - from);
+        string q;
+        for (size_t k = from; k < from + len; ++k) q += (k > from ? " " : "") + w[k];
+        if (rng() % 2) q.resize(q.size() - rng() % min<size_t>(w[from + len - 1].size(), 4));   // keep 1+ bytes
+        if (rng() % 4 == 0) q += ' ';
+        queries.push_back(q);
+    }
+
+    const size_t ks[] = {1, 5, 20, 100};
+    size_t mismatches = 0;
+    for (const string& q : queries) {
+        size_t k = ks[rng() % 4];
+        size_t total = 0;
+        vector<RankedMatch> got = index.search(q, k, &total);
+        vector<pair<double, size_t>> want = naive(q);
+        map<size_t, double> wantScore;
+        for (const auto& w : want) wantScore[w.second] = w.first;
+        auto close = [](double a, double b) { return fabs(a - b) <= 1e-3 * max(1.0, fabs(b)); };
+        bool ok = total == want.size() && got.size() == min(k, want.size());
+        for (size_t i = 0; ok && i < got.size(); ++i) {
+            // Near-ties may come out in either order, so compare scores by
+            // position and check each row's own score
+            auto it = wantScore.find(got[i].row);
+            ok = close(got[i].score, want[i].first) && it != wantScore.end() && close(got[i].score, it->second);
+        }
+        if (!ok && mismatches++ < 10) {
+            cerr << "search(\"" << q << "\", " << k << "): " << got.size() << " of " << total << ", expected "
+                 << min(k, want.size()) << " of " << want.size();
+            if (!got.empty() && !want.empty())
+                cerr << "; top row " << got[0].row << " " << got[0].score << ", expected " << want[0].second << " "
+                     << want[0].first;
+            cerr << "\n";
+        }
+    }
+    cout << "bm25: " << queries.size() << " queries over " << listed.size() << " names, " << mismatches
+         << " mismatches\n";
+    return mismatches;
+}
+
+// HistoryStore round trip: ingest a run of synthetic days built from
+// `base`, then read every game's series back and compare it with what
+// went in, value for value. Days skip ahead at random, games drop out and
+// come back, names change case and padding, ratings go blank, and counts
+// sometimes swing between 0 and INT64_MAX so every varint width is used.
+// risers() is checked against a brute-force scan of the same data.
+static size_t checkHistory(const GameTable& base) {
+    const int DAYS = 40;
+    string path = (filesystem::temp_directory_path() / "bench_check_history.bin").string();
+    remove(path.c_str());
+
+    struct Point {
+        int32_t day;
+        int64_t values[HISTORY_FIELDS];
+    };
+    map<string, vector<Point>> truth;   // by key, oldest first
+    map<string, string> shown;          // the name as last ingested
+    vector<array<int64_t, HISTORY_FIELDS>> state(base.size());
+    mt19937_64 rng(25);
+    for (size_t i = 0; i < base.size(); ++i)
+        state[i] = {base.rank[i], base.active[i], base.visits[i], base.favourites[i],
+                    base.likes[i], base.dislikes[i], (int64_t)(rng() % 10001)};
+
+    size_t mismatches = 0;
+    int32_t day = daysFromCivil(2024, 1, 1);
+    for (int d = 0; d < DAYS; ++d) {
+        day += d == 0 ? 0 : 1 + (int32_t)(rng() % 3);
+        GameTable t;
+        set<string> seen;
+        for (size_t i = 0; i < base.size(); ++i) {
+            if (rng() % 10 == 0) continue;   // missing today
+            auto& v = state[i];
+            v[0] = 1 + (int64_t)(rng() % (base.size() * 2));
+            for (int f = 1; f < 6; ++f) {
+                uint64_t r = rng();
+                int64_t step = r % 50 == 0 ? (int64_t)(rng() % (uint64_t)(INT64_MAX / 4)) : (int64_t)(r % 5000);
+                if (r % 97 == 0) v[f] = (r >> 32) % 2 ? INT64_MAX : 0;   // full-width deltas
+                else if ((r >> 32) % 3 == 0) v[f] -= min(step, v[f]);
+                else v[f] += min(step, INT64_MAX - v[f]);
+            }
+            int64_t cents = rng() % 20 == 0 ? -1 : (int64_t)(rng() % 10001);
+            v[6] = cents;
+            string name(base.name(i));
+            if (rng() % 8 == 0) name = "  " + name + " ";
+            if (rng() % 8 == 0)
+                for (char& c : name) c = (c >= 'a' && c <= 'z') ? (char)(c - 32) : c;
+            t.addRow((int32_t)v[0], name, v[1], v[2], v[3], v[4], v[5],
+                     cents < 0 ? NAN : (float)((double)cents / 100));
+
+            // The store keeps the first row per name, like ingest does
+            string key = foldCase(trim(name));
+            if (key.empty() || !seen.insert(key).second) continue;
+            Point p{day, {}};
+            copy(v.begin(), v.end(), p.values);
+            truth[key].push_back(p);
+            shown[key] = trim(name);
+        }
+        string error;
+        if (!HistoryStore::ingest(path, t, 0, day, error)) {
+            cerr << "ingest: " << error << "\n";
+            return 1;
+        }
+    }
+
+    HistoryStore store;
+    if (!store.open(path)) {
+        cerr << "Can't reopen " << path << "\n";
+        return 1;
+    }
+    auto report = [&](const string& what) {
+        if (mismatches++ < 10) cerr << "history: " << what << "\n";
+    };
+    if (store.games() != truth.size()) report(to_string(store.games()) + " games, expected " + to_string(truth.size()));
+    size_t points = 0;
+    for (const auto& [key, want] : truth) {
+        const HistoryGame* g = store.find(key);
+        if (!g) { report("\"" + key + "\" not found"); continue; }
+        if (store.name(*g) != shown[key]) report("\"" + key + "\" is shown as \"" + string(store.name(*g)) + "\"");
+        vector<HistoryPoint> got = store.series(*g, INT32_MIN);
+        bool same = got.size() == want.size();
+        for (size_t k = 0; same && k < got.size(); ++k)
+            same = got[k].day == want[k].day && equal(want[k].values, want[k].values + HISTORY_FIELDS, got[k].values);
+        if (!same) report("\"" + key + "\" decodes differently");
+        points += want.size();
+    }
+    if (store.find("no such game, surely")) report("found a game that was never ingested");
+
+    // risers: the baseline is the last record on or before the window
+    // start, else the first; biggest gain first, ties in key order
+    const int32_t window = 7;
+    const size_t n = 50;
+    int32_t latest = store.latestDay(), target = latest - window;
+    vector<tuple<int64_t, string, int32_t, int64_t>> brute;   // -gain, key, fromDay, before
+    for (const auto& [key, want] : truth) {
+        if (want.back().day != latest || want.size() < 2) continue;
+        const Point* from = &want.front();
+        for (const Point& p : want)
+            if (p.day <= target) from = &p;
+        if (from == &want.back()) continue;
+        int64_t before = from->values[1], after = want.back().values[1];
+        brute.emplace_back(-(after - before), key, from->day, before);
+    }
+    sort(brute.begin(), brute.end());
+    vector<HistoryRiser> risers = store.risers(window, n);
+    if (risers.size() != min(n, brute.size())) report("risers gave " + to_string(risers.size()) + " games");
+    for (size_t k = 0; k < risers.size() && k < brute.size(); ++k) {
+        const auto& [negGain, key, fromDay, before] = brute[k];
+        const HistoryRiser& r = risers[k];
+        if (store.name(*r.game) != shown[key] || r.fromDay != fromDay || r.before != before ||
+            r.after - r.before != -negGain)
+            report("riser " + to_string(k) + " is \"" + string(store.name(*r.game)) + "\", expected \"" + shown[key] + "\"");
+    }
+
+    cout << "history: " << DAYS << " days, " << truth.size() << " games, " << points << " points, " << mismatches
+         << " mismatches\n";
+    remove(path.c_str());
+    return mismatches;
+}
+
+static int runChecks(const string& which, const string& path) {
+    bool all = which == "all";
+    size_t failed = 0;
+    bool ran = false;
+    if (all || which == "counts") { failed += checkCounts(); ran = true; }
+    if (all || which == "bm25" || which == "history") {
+        GameTable table;
+        string header;
+        if (!loadGameTable(path, table, header)) {
+            cerr << "Can't open " << path << "\n";
+            return 1;
+        }
+        if (all || which == "bm25") failed += checkBm25(table);
+        if (all || which == "history") failed += checkHistory(table);
+        ran = true;
+    }
+    if (!ran) {
+        cerr << "Unknown check: " << which << "\n";
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    string mode = argc > 1 ? argv[1] : "csv";
+    if (mode == "csv") {
+        string path = argc > 2 ? argv[2] : "roblox_games.csv";
+        size_t copies = argc > 3 ? stoul(argv[3]) : 200;
+        return benchCSV(path, copies);
+    }
+    if (mode == "counts") {
+        string path = argc > 2 ? argv[2] : "roblox_games.csv";
+        size_t copies = argc > 3 ? stoul(argv[3]) : 200;
+        return benchCounts(path, copies);
+    }
+    if (mode == "gen" && argc > 3)
+        return benchGen(stoull(argv[2]), argv[3], argc > 4 ? stoull(argv[4]) : 1);
+    if (mode == "scale") {
+#ifdef BENCH_HAVE_FORK
+        string dir = argc > 2 ? argv[2] : "synth";
+        vector<uint64_t> sizes;
+        for (int i = 3; i < argc; ++i) sizes.push_back(stoull(argv[i]));
+        if (sizes.empty()) sizes = {10000, 100000, 1000000, 10000000};
+        return benchScale(dir, sizes);
+#else
+        cerr << "The scaling run needs fork()\n";
+        return 1;
+#endif
+    }
+    if (mode == "check") return runChecks(argc > 2 ? argv[2] : "all", argc > 3 ? argv[3] : "roblox_games.csv");
+    cerr << "Unknown benchmark: " << mode << "\n";
+    return 1;
+}
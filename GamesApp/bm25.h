@@ -0,0 +1,272 @@
+#ifndef BM25_H
+#define BM25_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "case_fold.h"
+#include "game_table.h"
+#include "metrics.h"
+
+// One ranked search hit
+struct RankedMatch {
+    size_t row;
+    float score;   // BM25 over the query words plus the popularity prior
+};
+
+// Word-level inverted index over the case-folded names, ranked with BM25.
+//
+// Words are runs of ASCII letters and digits, so "Brookhaven 🏡RP" is
+// "brookhaven" + "rp". Every word maps to its rows and how often it occurs
+// in each. A query scores each row that has any of its words; the last
+// word also matches as a prefix, so "blox fru" finds "fruits". Each row
+// then gets a popularity prior from log active players and log visits, so
+// among equally good name matches the games people play come first. Only
+// a k-sized heap is kept while scoring; the matches are never sorted.
+class RelevanceIndex {
+public:
+    static constexpr float K1 = 1.2f;            // term frequency saturation
+    static constexpr float B = 0.75f;            // name length normalization
+    static constexpr float PRIOR_WEIGHT = 2.0f;  // most popular vs least, ~ one common word
+    static const size_t MAX_PREFIX_TERMS = 64;   // expansions of the last word, most common first
+    static const size_t MAX_PREFIX_WALK = 16384; // terms looked at to pick them
+
+    void build(const GameTable& table) {
+        rows = table.size();
+        docLength.assign(rows, 0);
+        prior.assign(rows, 0.0f);
+
+        // Words get ids in first-seen order while the postings are
+        // collected, then are renumbered alphabetically so prefixes are
+        // contiguous
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::vector<std::string_view> vocab;
+        std::vector<uint64_t> packed;   // (term, row, tf) in row order
+        packed.reserve(rows * 3);
+        std::vector<std::pair<uint32_t, uint32_t>> words;   // one name's (term, tf)
+        double totalLength = 0;
+        size_t docs = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            if (!table.listed(i)) continue;
+            words.clear();
+            uint32_t length = 0;
+            forEachWord(table.foldedName(i), [&](std::string_view w) {
+                auto it = ids.emplace(w, (uint32_t)vocab.size()).first;
+                if (it->second == vocab.size()) vocab.push_back(w);
+                ++length;
+                for (auto& e : words)
+                    if (e.first == it->second) { ++e.second; return; }
+                words.push_back({it->second, 1});
+            });
+            docLength[i] = (uint16_t)std::min<uint32_t>(length, 65535);
+            totalLength += length;
+            ++docs;
+            for (const auto& e : words)
+                packed.push_back((uint64_t)e.first << 40 | (uint64_t)i << 8 | std::min<uint32_t>(e.second, 255));
+        }
+
+        std::vector<uint32_t> order(vocab.size()), renumber(vocab.size());
+        for (uint32_t t = 0; t < order.size(); ++t) order[t] = t;
+        std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) { return vocab[x] < vocab[y]; });
+        termText.clear();
+        termStart.assign(1, 0);
+        for (uint32_t t = 0; t < order.size(); ++t) {
+            renumber[order[t]] = t;
+            termText.insert(termText.end(), vocab[order[t]].begin(), vocab[order[t]].end());
+            termStart.push_back((uint64_t)termText.size());
+        }
+        avgLength = docs ? (float)(totalLength / (double)docs) : 1.0f;
+        docCount = docs;
+
+        // Rows went in ascending, so a stable counting scatter by term
+        // leaves each posting list sorted by row without a sort
+        termOffset.assign(vocab.size() + 1, 0);
+        for (uint64_t p : packed) ++termOffset[renumber[p >> 40] + 1];
+        for (size_t t = 1; t < termOffset.size(); ++t) termOffset[t] += termOffset[t - 1];
+        std::vector<uint64_t> next(termOffset.begin(), termOffset.end() - 1);
+        postingRow.resize(packed.size());
+        postingTf.resize(packed.size());
+        for (uint64_t p : packed) {
+            uint64_t k = next[renumber[p >> 40]]++;
+            postingRow[k] = (uint32_t)(p >> 8);
+            postingTf[k] = (uint8_t)p;
+        }
+
+        // Prior: log active players and log visits, each scaled so the
+        // least popular row is 0 and the most popular 1. Every listed game
+        // has thousands of visits, so unscaled logs would all sit near the top
+        std::vector<float> logVisits(rows);
+        float loActive = INFINITY, hiActive = 0, loVisits = INFINITY, hiVisits = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            prior[i] = (float)std::log1p((double)std::max<int64_t>(0, table.active[i]));
+            logVisits[i] = (float)std::log1p((double)std::max<int64_t>(0, table.visits[i]));
+            loActive = std::min(loActive, prior[i]);
+            hiActive = std::max(hiActive, prior[i]);
+            loVisits = std::min(loVisits, logVisits[i]);
+            hiVisits = std::max(hiVisits, logVisits[i]);
+        }
+        float wa = hiActive > loActive ? PRIOR_WEIGHT * 0.6f / (hiActive - loActive) : 0;
+        float wv = hiVisits > loVisits ? PRIOR_WEIGHT * 0.4f / (hiVisits - loVisits) : 0;
+        for (size_t i = 0; i < rows; ++i)
+            prior[i] = wa * (prior[i] - loActive) + wv * (logVisits[i] - loVisits);
+    }
+
+    size_t terms() const { return termOffset.empty() ? 0 : termOffset.size() - 1; }
+
+    // The k best rows for `query`, best first (ties in file order).
+    // `total` gets how many rows matched at least one word, and
+    // `matchedRows` all of those rows, in no particular order.
+    std::vector<RankedMatch> search(const std::string& query, size_t k, size_t* total = nullptr,
+                                    std::vector<uint32_t>* matchedRows = nullptr) const {
+        std::vector<RankedMatch> out;
+        if (total) *total = 0;
+        if (matchedRows) matchedRows->clear();
+        std::string q = foldCase(query);
+        std::vector<std::string_view> words;
+        forEachWord(q, [&](std::string_view w) { words.push_back(w); });
+        if (words.empty() || rows == 0 || k == 0) return out;
+        // Is the query's last word complete? A trailing space says so
+        bool lastIsPrefix = !q.empty() && isWordByte(q.back());
+
+        std::vector<uint32_t> matched;
+        for (size_t w = 0; w < words.size(); ++w) {
+            if (w + 1 == words.size() && lastIsPrefix) {
+                expandPrefix(words[w], matched);
+            } else {
+                size_t t;
+                if (findTerm(words[w], t)) matched.push_back((uint32_t)t);
+            }
+        }
+        std::sort(matched.begin(), matched.end());
+        matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+        if (matched.empty()) return out;
+
+        // Term at a time into a per-thread scratch accumulator. Rows touched
+        // are listed once, so the heap pass only visits matches and only
+        // their slots are cleared afterwards; nothing is sized per query
+        thread_local std::vector<float> score;
+        if (score.size() < rows) score.resize(rows, 0.0f);
+        std::vector<uint32_t> touched;
+        size_t scanned = 0;
+        for (uint32_t t : matched) {
+            uint64_t begin = termOffset[t], end = termOffset[t + 1];
+            double df = (double)docFreq(t);
+            float idf = (float)std::log(1.0 + ((double)docCount - df + 0.5) / (df + 0.5));
+            for (uint64_t p = begin; p < end; ++p) {
+                uint32_t row = postingRow[p];
+                float tf = postingTf[p];
+                float norm = K1 * (1.0f - B + B * (float)docLength[row] / avgLength);
+                if (score[row] == 0.0f) touched.push_back(row);
+                score[row] += idf * tf * (K1 + 1.0f) / (tf + norm);
+            }
+            scanned += (size_t)(end - begin);
+        }
+        metrics::addRows(scanned);
+        if (total) *total = touched.size();
+        if (matchedRows) *matchedRows = touched;
+
+        // Min-heap of the best k so far; the root is the one to beat
+        auto better = [](const RankedMatch& a, const RankedMatch& b) {
+            return a.score != b.score ? a.score > b.score : a.row < b.row;
+        };
+        std::priority_queue<RankedMatch, std::vector<RankedMatch>, decltype(better)> heap(better);
+        for (uint32_t row : touched) {
+            RankedMatch m{row, score[row] + prior[row]};
+            score[row] = 0.0f;
+            if (heap.size() < k) heap.push(m);
+            else if (better(m, heap.top())) { heap.pop(); heap.push(m); }
+        }
+        out.resize(heap.size());
+        for (size_t i = out.size(); i-- > 0; heap.pop()) out[i] = heap.top();
+        return out;
+    }
+
+private:
+    size_t rows = 0;
+    size_t docCount = 0;
+    float avgLength = 1.0f;
+    std::vector<char> termText;        // sorted vocabulary, back to back
+    std::vector<uint64_t> termStart;   // term t is termText[termStart[t], termStart[t + 1])
+    std::vector<uint64_t> termOffset;  // term t's postings are [termOffset[t], termOffset[t + 1])
+    std::vector<uint32_t> postingRow;
+    std::vector<uint8_t> postingTf;
+    std::vector<uint16_t> docLength;   // words per name
+    std::vector<float> prior;
+
+    static bool isWordByte(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z');
+    }
+
+    template <class F>
+    static void forEachWord(std::string_view s, F&& f) {
+        size_t i = 0;
+        while (i < s.size()) {
+            while (i < s.size() && !isWordByte(s[i])) ++i;
+            size_t start = i;
+            while (i < s.size() && isWordByte(s[i])) ++i;
+            if (i > start) f(s.substr(start, i - start));
+        }
+    }
+
+    std::string_view term(size_t t) const {
+        return std::string_view(termText.data() + termStart[t], (size_t)(termStart[t + 1] - termStart[t]));
+    }
+
+    // First term >= w
+    size_t lowerBound(std::string_view w) const {
+        size_t lo = 0, hi = terms();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (term(mid) < w) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    bool findTerm(std::string_view w, size_t& t) const {
+        t = lowerBound(w);
+        return t < terms() && term(t) == w;
+    }
+
+    // Terms that start with w, which sit together in the sorted vocabulary
+    std::pair<size_t, size_t> prefixRange(std::string_view w) const {
+        size_t begin = lowerBound(w), lo = begin, hi = terms();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (term(mid).substr(0, w.size()) == w) lo = mid + 1;
+            else hi = mid;
+        }
+        return {begin, lo};
+    }
+
+    size_t docFreq(size_t t) const { return (size_t)(termOffset[t + 1] - termOffset[t]); }
+
+    // Add the terms `w` expands to: itself if it is a word, plus the
+    // MAX_PREFIX_TERMS that start it and are in the most names, so "sim"
+    // reaches "simulator" however many rarer words sort before it. Only
+    // the first MAX_PREFIX_WALK terms of the range are considered.
+    void expandPrefix(std::string_view w, std::vector<uint32_t>& out) const {
+        auto range = prefixRange(w);
+        size_t end = std::min(range.second, range.first + MAX_PREFIX_WALK);
+        if (range.first < end && term(range.first) == w) out.push_back((uint32_t)range.first);
+        if (end - range.first <= MAX_PREFIX_TERMS) {
+            for (size_t t = range.first; t < end; ++t) out.push_back((uint32_t)t);
+            return;
+        }
+        std::vector<uint32_t> candidates(end - range.first);
+        for (size_t t = range.first; t < end; ++t) candidates[t - range.first] = (uint32_t)t;
+        // Ties go to the term that sorts first
+        std::nth_element(candidates.begin(), candidates.begin() + MAX_PREFIX_TERMS, candidates.end(),
+                         [&](uint32_t a, uint32_t b) {
+                             return docFreq(a) != docFreq(b) ? docFreq(a) > docFreq(b) : a < b;
+                         });
+        out.insert(out.end(), candidates.begin(), candidates.begin() + MAX_PREFIX_TERMS);
+    }
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef CASE_FOLD_H
+#define CASE_FOLD_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Simple (one-to-one) case folding for UTF-8 text. ASCII goes through a
+// 16-bytes-at-a-time path; everything else is decoded and folded for the
+// scripts that actually show up in game names (Latin-1, Latin Extended-A,
+// Greek, Cyrillic, fullwidth Latin). Emoji and anything we don't fold pass
+// through unchanged, as do bytes that aren't valid UTF-8.
+
+// Lowercase 16 ASCII bytes from src into dst. Returns false (and writes
+// nothing) if any byte in the block is non-ASCII.
+inline bool foldASCII16(const char* src, char* dst) {
+#if defined(__SSE2__)
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    if (_mm_movemask_epi8(v) != 0) return false;
+    // Signed compares are fine here since every byte is below 0x80
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    v = _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v);
+    return true;
+#elif defined(__ARM_NEON)
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src));
+    if (vmaxvq_u8(v) >= 0x80) return false;
+    uint8x16_t upper = vcleq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8('Z' - 'A'));
+    v = vaddq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+    vst1q_u8(reinterpret_cast<uint8_t*>(dst), v);
+    return true;
+#else
+    for (int i = 0; i < 16; ++i)
+        if ((unsigned char)src[i] >= 0x80) return false;
+    for (int i = 0; i < 16; ++i) {
+        char c = src[i];
+        dst[i] = (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+    }
+    return true;
+#endif
+}
+
+// Fold a single code point
+inline uint32_t foldCodePoint(uint32_t cp) {
+    if (cp < 0x80) return (cp >= 'A' && cp <= 'Z') ? cp + 32 : cp;
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return cp + 32;          // À..Þ
+    if (cp == 0x130) return 'i';                                         // İ, not dotless ı
+    if (cp >= 0x100 && cp <= 0x137) return cp | 1;                       // Ā..ķ pairs
+    if (cp >= 0x139 && cp <= 0x148) return (cp & 1) ? cp + 1 : cp;       // Ĺ..ň pairs
+    if (cp >= 0x14A && cp <= 0x177) return cp | 1;                       // Ŋ..ŷ pairs
+    if (cp == 0x178) return 0xFF;                                        // Ÿ
+    if (cp >= 0x179 && cp <= 0x17E) return (cp & 1) ? cp + 1 : cp;      // Ź..ž pairs
+    if (cp >= 0x391 && cp <= 0x3AB && cp != 0x3A2) return cp + 32;      // Greek capitals
+    if (cp >= 0x400 && cp <= 0x40F) return cp + 80;                      // Ѐ..Џ
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 32;                      // А..Я
+    if (cp >= 0xFF21 && cp <= 0xFF3A) return cp + 32;                    // Ａ..Ｚ
+    return cp;
+}
+
+// Decode one UTF-8 sequence at s[i]. Returns its length, or 0 if invalid.
+inline size_t decodeUTF8(std::string_view s, size_t i, uint32_t& cp) {
+    unsigned char c = (unsigned char)s[i];
+    size_t len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+    if (len == 0 || i + len > s.size()) return 0;
+    cp = len == 1 ? c : len == 2 ? (c & 0x1F) : len == 3 ? (c & 0x0F) : (c & 0x07);
+    for (size_t k = 1; k < len; ++k) {
+        unsigned char cc = (unsigned char)s[i + k];
+        if ((cc & 0xC0) != 0x80) return 0;
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    return len;
+}
+
+inline void appendUTF8(uint32_t cp, std::vector<char>& out) {
+    if (cp < 0x80) {
+        out.push_back((char)cp);
+    } else if (cp < 0x800) {
+        out.push_back((char)(0xC0 | (cp >> 6)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back((char)(0xE0 | (cp >> 12)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back((char)(0xF0 | (cp >> 18)));
+        out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+// Append the case-folded form of s to out
+inline void foldCaseAppend(std::string_view s, std::vector<char>& out) {
+    size_t i = 0;
+    size_t scalarUntil = 0;  // after a non-ASCII block, go byte by byte past it
+    while (i < s.size()) {
+        if (i >= scalarUntil && i + 16 <= s.size()) {
+            size_t at = out.size();
+            out.resize(at + 16);
+            if (foldASCII16(s.data() + i, out.data() + at)) { i += 16; continue; }
+            out.resize(at);
+            scalarUntil = i + 16;
+        }
+        unsigned char c = (unsigned char)s[i];
+        if (c < 0x80) {
+            out.push_back((c >= 'A' && c <= 'Z') ? (char)(c + 32) : (char)c);
+            ++i;
+            continue;
+        }
+        uint32_t cp = 0;
+        size_t len = decodeUTF8(s, i, cp);
+        if (len == 0) {
+            out.push_back((char)c);
+            ++i;
+            continue;
+        }
+        uint32_t folded = foldCodePoint(cp);
+        if (folded == cp) out.insert(out.end(), s.begin() + (std::ptrdiff_t)i, s.begin() + (std::ptrdiff_t)(i + len));
+        else appendUTF8(folded, out);
+        i += len;
+    }
+}
+
+inline std::string foldCase(std::string_view s) {
+    std::vector<char> out;
+    out.reserve(s.size());
+    foldCaseAppend(s, out);
+    return std::string(out.begin(), out.end());
+}
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef COOCCUR_H
+#define COOCCUR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "favorites.h"
+#include "game_table.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+
+// "Users who favorited X also favorited Y", mined from every user's
+// favorites_<name>.csv. A background thread reads all the files in
+// parallel and builds a sparse game x game co-occurrence matrix in CSR
+// form; queries read straight out of it once it's ready. The result is
+// kept in <dir>/favorites.graph, keyed by every favorites file's name,
+// size and mtime and by the games the rows stand for, so a later start
+// with nothing changed loads it instead of rereading every file.
+class FavoritesGraph {
+public:
+    struct Entry {
+        size_t row;
+        uint32_t count;
+    };
+
+    // Users with more favorites than this only contribute their first ones,
+    // so one huge list can't blow up the pair count
+    static const size_t MAX_FAVORITES_PER_USER = 200;
+
+    ~FavoritesGraph() { wait(); }
+
+    // Start building in the background from the favorites files in `dir`
+    void start(const GameTable& table, const std::string& dir = ".") {
+        wait();
+        done = false;
+        worker = std::thread([this, &table, dir] {
+            build(table, dir);
+            done.store(true, std::memory_order_release);
+        });
+    }
+
+    void wait() {
+        if (worker.joinable()) worker.join();
+    }
+
+    bool ready() const { return done.load(std::memory_order_acquire); }
+    size_t users() const { return userCount; }
+
+    // Games most often favorited together with `row`, most shared first
+    std::vector<Entry> alsoFavorited(size_t row, size_t k) const {
+        std::vector<Entry> out;
+        if (!ready() || row + 1 >= rowStart.size()) return out;
+        for (uint64_t p = rowStart[row]; p < rowStart[row + 1] && out.size() < k; ++p)
+            out.push_back({neighbors[p], counts[p]});
+        return out;
+    }
+
+    // Games on the most users' favorites lists
+    std::vector<Entry> mostFavorited(size_t k) const {
+        std::vector<Entry> out;
+        if (!ready()) return out;
+        for (size_t i = 0; i < popular.size() && out.size() < k; ++i)
+            out.push_back({popular[i], popularity[popular[i]]});
+        return out;
+    }
+
+private:
+    std::thread worker;
+    std::atomic<bool> done{false};
+    size_t userCount = 0;
+
+    // CSR: row r's neighbors are neighbors[rowStart[r], rowStart[r+1]),
+    // sorted by how many users share them
+    std::vector<uint64_t> rowStart;
+    std::vector<uint32_t> neighbors;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> popularity;   // users per game
+    std::vector<uint32_t> popular;      // rows with popularity > 0, most first
+
+    // What a saved graph was built from. csvBytes and csvMtime get the
+    // total size and newest mtime; the hash covers each file's name, size
+    // and mtime and each row's key and rank, since neighbors are row ids.
+    static SnapshotKey graphKey(const GameTable& table, const std::vector<std::string>& files) {
+        SnapshotKey key;
+        std::string seen;
+        for (const std::string& f : files) {
+            std::error_code ec;
+            uint64_t bytes = std::filesystem::file_size(f, ec);
+            if (ec) bytes = 0;
+            auto mtime = std::filesystem::last_write_time(f, ec);
+            int64_t m = ec ? 0 : (int64_t)mtime.time_since_epoch().count();
+            key.csvBytes += bytes;
+            key.csvMtime = std::max(key.csvMtime, m);
+            seen.append(f).push_back('\0');
+            seen.append(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+            seen.append(reinterpret_cast<const char*>(&m), sizeof(m));
+        }
+        for (size_t i = 0; i < table.size(); ++i) {
+            seen.append(table.key(i)).push_back('\n');
+            seen.append(reinterpret_cast<const char*>(&table.rank[i]), sizeof(table.rank[i]));
+        }
+        key.csvHash = hashBytes(seen.data(), seen.size());
+        return key;
+    }
+
+    bool save(const std::string& path, const SnapshotKey& key) const {
+        std::vector<uint64_t> users{userCount};
+        return writeSnapshotFile(path, key, [&](SnapshotWriter& w) {
+            w.put("users", users);
+            w.put("rowStart", rowStart);
+            w.put("neighbors", neighbors);
+            w.put("counts", counts);
+            w.put("popularity", popularity);
+            w.put("popular", popular);
+        });
+    }
+
+    // Load a saved graph for a table of `rows` rows, checking that every
+    // row id in it is in range. Leaves the graph empty on failure.
+    bool load(const std::string& path, const SnapshotKey& key, size_t rows) {
+        SnapshotReader snap;
+        std::vector<uint64_t> users;
+        bool ok = snap.open(path, key) && snap.get("users", users) && users.size() == 1 &&
+                  snap.get("rowStart", rowStart) && snap.get("neighbors", neighbors) &&
+                  snap.get("counts", counts) && snap.get("popularity", popularity) &&
+                  snap.get("popular", popular) && rowStart.size() == rows + 1 && rowStart[0] == 0 &&
+                  rowStart[rows] == neighbors.size() && counts.size() == neighbors.size() &&
+                  popularity.size() == rows;
+        for (size_t r = 0; ok && r < rows; ++r) ok = rowStart[r] <= rowStart[r + 1];
+        for (size_t i = 0; ok && i < neighbors.size(); ++i) ok = neighbors[i] < rows;
+        for (size_t i = 0; ok && i < popular.size(); ++i) ok = popular[i] < rows;
+        if (!ok) {
+            rowStart.clear();
+            neighbors.clear();
+            counts.clear();
+            popularity.clear();
+            popular.clear();
+            return false;
+        }
+        userCount = (size_t)users[0];
+        return true;
+    }
+
+    static bool isFavoritesFile(const std::filesystem::path& p) {
+        std::string name = p.filename().string();
+        return name.rfind("favorites_", 0) == 0 && p.extension() == ".csv";
+    }
+
+    // Rows currently in one favorites log, sorted and de-duplicated
+    static std::vector<uint32_t> readFavorites(const std::string& path, const FavoriteResolver& games) {
+        std::vector<std::pair<int32_t, uint32_t>> added;   // (logged rank, row)
+        MappedFile file;
+        if (!file.open(path)) return {};
+        replayFavoritesLog(file.view(),
+            [&](const std::string& name, int32_t rank, std::string_view) {
+                size_t row;
+                if (added.size() < MAX_FAVORITES_PER_USER && games.find(GameTable::keyOf(name), rank, row))
+                    added.push_back({rank, (uint32_t)row});
+            },
+            [&](const std::string& name, int32_t rank, std::string_view) {
+                size_t row = SIZE_MAX;
+                if (!name.empty() && !games.find(GameTable::keyOf(name), rank, row)) return;
+                for (size_t i = 0; i < added.size(); ++i) {
+                    if (name.empty() ? added[i].first == rank : added[i].second == row) {
+                        added.erase(added.begin() + (std::ptrdiff_t)i);
+                        break;
+                    }
+                }
+            });
+        std::vector<uint32_t> rows;
+        for (const auto& a : added) rows.push_back(a.second);
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        return rows;
+    }
+
+    void build(const GameTable& table, const std::string& dir) {
+        FavoriteResolver games(table);
+
+        std::vector<std::string> files;
+        std::error_code ec;
+        for (const auto& e : std::filesystem::directory_iterator(dir, ec))
+            if (e.is_regular_file(ec) && isFavoritesFile(e.path())) files.push_back(e.path().string());
+        std::sort(files.begin(), files.end());
+        std::string cachePath = dir + "/favorites.graph";
+        SnapshotKey key = graphKey(table, files);
+        if (load(cachePath, key, table.size())) return;
+        userCount = files.size();
+
+        // Each thread takes every n-th file; lists are kept per user, so
+        // memory is one entry per favorite rather than per pair
+        unsigned threads = std::max(1u, std::min<unsigned>(std::thread::hardware_concurrency(),
+                                                          (unsigned)(files.size() / 64 + 1)));
+        std::vector<std::vector<uint32_t>> lists(files.size());
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (size_t f = t; f < files.size(); f += threads) lists[f] = readFavorites(files[f], games);
+            });
+        }
+        for (auto& w : workers) w.join();
+        workers.clear();
+
+        // Users per game, as CSR: game r's users are users[userStart[r], userStart[r+1])
+        size_t rows = table.size();
+        popularity.assign(rows, 0);
+        for (const auto& l : lists)
+            for (uint32_t r : l) ++popularity[r];
+        std::vector<uint64_t> userStart(rows + 1, 0);
+        for (size_t r = 0; r < rows; ++r) userStart[r + 1] = userStart[r] + popularity[r];
+        std::vector<uint32_t> users(userStart[rows]);
+        {
+            std::vector<uint64_t> next(userStart.begin(), userStart.end() - 1);
+            for (size_t u = 0; u < lists.size(); ++u)
+                for (uint32_t r : lists[u]) users[next[r]++] = (uint32_t)u;
+        }
+        popular.clear();
+        for (size_t i = 0; i < rows; ++i)
+            if (popularity[i] > 0) popular.push_back((uint32_t)i);
+        std::stable_sort(popular.begin(), popular.end(),
+                         [&](uint32_t a, uint32_t b) { return popularity[a] > popularity[b]; });
+
+        // Each thread owns a contiguous block of rows. A row's co-counts go
+        // into a scratch array indexed by game; only the slots it touched
+        // are read back and cleared, so the array is reused row to row.
+        // Blocks come out in row order and concatenate into the CSR
+        threads = std::max(1u, std::min<unsigned>(std::thread::hardware_concurrency(),
+                                                  (unsigned)(popular.size() / 256 + 1)));
+        std::vector<std::vector<uint32_t>> blockNeighbors(threads), blockCounts(threads);
+        rowStart.assign(rows + 1, 0);
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                size_t lo = rows * t / threads, hi = rows * (t + 1) / threads;
+                std::vector<uint32_t> acc(rows, 0);
+                std::vector<uint32_t> touched;
+                for (size_t a = lo; a < hi; ++a) {
+                    touched.clear();
+                    for (uint64_t p = userStart[a]; p < userStart[a + 1]; ++p)
+                        for (uint32_t b : lists[users[p]])
+                            if (b != a && acc[b]++ == 0) touched.push_back(b);
+                    // Most shared first so top-k is a prefix; ties in row order
+                    std::sort(touched.begin(), touched.end(), [&](uint32_t x, uint32_t y) {
+                        return acc[x] != acc[y] ? acc[x] > acc[y] : x < y;
+                    });
+                    for (uint32_t b : touched) {
+                        blockNeighbors[t].push_back(b);
+                        blockCounts[t].push_back(acc[b]);
+                        acc[b] = 0;
+                    }
+                    rowStart[a + 1] = touched.size();
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+
+        for (size_t r = 1; r < rowStart.size(); ++r) rowStart[r] += rowStart[r - 1];
+        neighbors.clear();
+        counts.clear();
+        neighbors.reserve(rowStart[rows]);
+        counts.reserve(rowStart[rows]);
+        for (unsigned t = 0; t < threads; ++t) {
+            neighbors.insert(neighbors.end(), blockNeighbors[t].begin(), blockNeighbors[t].end());
+            counts.insert(counts.end(), blockCounts[t].begin(), blockCounts[t].end());
+        }
+        save(cachePath, key);   // best effort; without it the next start rebuilds
+    }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef COUNT_PARSE_H
+#define COUNT_PARSE_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Counts in roblox_games.csv look like "41,346,317,182": a lead group of
+// 1-3 digits, then ",ddd" groups, two of which are checked and converted
+// at a time in one 64-bit word. Anything else falls back to from_chars or
+// a byte loop that still accepts stray separators, and reports what it
+// can't read.
+enum CountStatus {
+    COUNT_OK = 0,
+    COUNT_EMPTY,       // blank cell
+    COUNT_MALFORMED,   // something other than digits and separators
+    COUNT_OVERFLOW,    // more than fits in int64
+};
+
+inline const char* countStatusName(CountStatus s) {
+    switch (s) {
+    case COUNT_OK: return "ok";
+    case COUNT_EMPTY: return "empty";
+    case COUNT_MALFORMED: return "malformed";
+    case COUNT_OVERFLOW: return "overflow";
+    }
+    return "?";
+}
+
+namespace count_detail {
+
+// Two groups ",ddd,ddd" from 8 bytes at p, as one 6-digit value.
+// False if the bytes don't have exactly that shape.
+inline bool twoGroups(const char* p, uint64_t& out) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);   // the lanes below want p[0] in the low byte
+#endif
+    const uint64_t COMMAS = 0x000000FF000000FFull;
+    if ((v & COMMAS) != 0x0000002C0000002Cull) return false;
+    // Treat the commas as '0' so the word is eight digits "0ddd0ddd"
+    v = (v & ~COMMAS) | 0x0000003000000030ull;
+    if (((v + 0x4646464646464646ull) | (v - 0x3030303030303030ull)) & 0x8080808080808080ull) return false;
+    v -= 0x3030303030303030ull;
+    v = (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FFull;     // pairs of digits
+    v = (v * 100 + (v >> 16)) & 0x0000FFFF0000FFFFull;   // 4-digit halves
+    out = (v & 0xFFFF) * 1000 + (v >> 32);
+    return true;
+}
+
+// One ",ddd" group
+inline bool oneGroup(const char* p, uint64_t& out) {
+    unsigned a = (unsigned char)p[1] - '0', b = (unsigned char)p[2] - '0', c = (unsigned char)p[3] - '0';
+    if (p[0] != ',' || a > 9 || b > 9 || c > 9) return false;
+    out = a * 100 + b * 10 + c;
+    return true;
+}
+
+// Byte loop for irregular input: digits with ',' or ' ' anywhere
+inline CountStatus slowCount(std::string_view s, int64_t& out) {
+    uint64_t v = 0;
+    bool any = false;
+    for (char c : s) {
+        if (c >= '0' && c <= '9') {
+            if (v > (uint64_t)(INT64_MAX - (c - '0')) / 10) return COUNT_OVERFLOW;
+            v = v * 10 + (uint64_t)(c - '0');
+            any = true;
+        } else if (c != ',' && c != ' ') {
+            return COUNT_MALFORMED;
+        }
+    }
+    if (!any) return COUNT_MALFORMED;
+    out = (int64_t)v;
+    return COUNT_OK;
+}
+
+// Everything that isn't exactly "d[d[d]](,ddd)*": padding, plain digit
+// runs, odd grouping, junk
+inline CountStatus otherCount(std::string_view s, int64_t& out) {
+    while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\r')) s.remove_suffix(1);
+    if (s.empty()) return COUNT_EMPTY;
+    // Unsigned from_chars rejects a sign, so "-5" ends up malformed
+    uint64_t v = 0;
+    auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (r.ec == std::errc::result_out_of_range) return COUNT_OVERFLOW;
+    if (r.ec != std::errc() || r.ptr != s.data() + s.size()) return slowCount(s, out);
+    if (v > (uint64_t)INT64_MAX) return COUNT_OVERFLOW;
+    out = (int64_t)v;
+    return COUNT_OK;
+}
+
+} // namespace count_detail
+
+// Parse a count cell (quotes already stripped). Never throws or
+// allocates; `out` is 0 unless the result is COUNT_OK.
+//
+// The fast path goes by length alone: a well-formed cell of n bytes has a
+// lead group of n % 4 digits followed by (n / 4) ",ddd" groups, so there
+// is no scanning for separators and no per-digit branching.
+inline CountStatus readCount(std::string_view s, int64_t& out) {
+    out = 0;
+    size_t n = s.size();
+    size_t lead = n % 4;
+    if (lead == 0 || n > 23) return count_detail::otherCount(s, out);
+    const char* p = s.data();
+    const char* end = p + n;
+    uint64_t v = 0;
+    for (size_t k = 0; k < lead; ++k) {
+        unsigned d = (unsigned)(p[k] - '0');
+        if (d > 9) return count_detail::otherCount(s, out);
+        v = v * 10 + d;
+    }
+    p += lead;
+
+    // Two groups (six digits) per step
+    uint64_t g;
+    for (; end - p >= 8; p += 8) {
+        if (!count_detail::twoGroups(p, g)) return count_detail::otherCount(s, out);
+        if (v > ((uint64_t)INT64_MAX - g) / 1000000) return COUNT_OVERFLOW;
+        v = v * 1000000 + g;
+    }
+    if (p < end) {
+        if (!count_detail::oneGroup(p, g)) return count_detail::otherCount(s, out);
+        if (v > ((uint64_t)INT64_MAX - g) / 1000) return COUNT_OVERFLOW;
+        v = v * 1000 + g;
+    }
+    out = (int64_t)v;
+    return COUNT_OK;
+}
+
+// Boolean form for callers that only care whether it parsed
+inline bool parseCount(std::string_view s, int64_t& out) {
+    return readCount(s, out) == COUNT_OK;
+}
+
+#endif
@@ -0,0 +1,326 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// One field read straight out of a CSV buffer. Surrounding quotes are
+// stripped; `escaped` means the text still contains "" pairs and has to go
+// through unescapeCSV before it is shown to anyone.
+struct CsvField {
+    std::string_view text;
+    bool escaped = false;
+};
+
+// Read the field that starts at `pos`. Returns the position just past the
+// delimiter and sets endOfRecord when the field was the last one on its line.
+// Quoted fields may contain commas, "" and newlines. This is the scalar
+// version; CsvScanner below does the same job 64 bytes at a time.
+inline size_t readCSVField(std::string_view buf, size_t pos, CsvField& out, bool& endOfRecord) {
+    const size_t n = buf.size();
+    out.escaped = false;
+    endOfRecord = false;
+
+    if (pos < n && buf[pos] == '"') {
+        size_t start = ++pos;
+        while (pos < n) {
+            if (buf[pos] == '"') {
+                if (pos + 1 < n && buf[pos + 1] == '"') { out.escaped = true; pos += 2; continue; }
+                break;
+            }
+            ++pos;
+        }
+        out.text = buf.substr(start, pos - start);
+        if (pos < n) ++pos;  // closing quote
+        // Anything between the closing quote and the delimiter is dropped
+        while (pos < n && buf[pos] != ',' && buf[pos] != '\n') ++pos;
+    } else {
+        size_t start = pos;
+        while (pos < n && buf[pos] != ',' && buf[pos] != '\n') ++pos;
+        size_t end = pos;
+        if (end > start && buf[end - 1] == '\r') --end;
+        out.text = buf.substr(start, end - start);
+    }
+
+    if (pos >= n) { endOfRecord = true; return n; }
+    if (buf[pos] == '\n') endOfRecord = true;
+    return pos + 1;
+}
+
+// Skip to the start of the next record without looking at the fields
+inline size_t skipCSVRecord(std::string_view buf, size_t pos) {
+    CsvField f;
+    bool eor = false;
+    while (pos < buf.size() && !eor) pos = readCSVField(buf, pos, f, eor);
+    return pos;
+}
+
+// Turn "" back into " for a field that had escaped quotes
+inline std::string unescapeCSV(std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        out.push_back(s[i]);
+        if (s[i] == '"' && i + 1 < s.size() && s[i + 1] == '"') ++i;
+    }
+    return out;
+}
+
+// ---- Vectorized delimiter search ----
+
+// Bitmasks for one 64-byte block: bit i is set when byte i matches
+struct CsvBlockMasks {
+    uint64_t quote, comma, newline;
+};
+
+inline CsvBlockMasks csvBlockMasksScalar(const char* p) {
+    CsvBlockMasks m{0, 0, 0};
+    for (int i = 0; i < 64; ++i) {
+        uint64_t bit = uint64_t(1) << i;
+        if (p[i] == '"') m.quote |= bit;
+        else if (p[i] == ',') m.comma |= bit;
+        else if (p[i] == '\n') m.newline |= bit;
+    }
+    return m;
+}
+
+#if defined(__AVX2__)
+inline CsvBlockMasks csvBlockMasks(const char* p) {
+    const __m256i q = _mm256_set1_epi8('"'), c = _mm256_set1_epi8(','), nl = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    auto bits = [&](__m256i needle) {
+        uint64_t a = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle));
+        uint64_t b = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle));
+        return a | (b << 32);
+    };
+    return CsvBlockMasks{bits(q), bits(c), bits(nl)};
+}
+#elif defined(__SSE2__)
+inline CsvBlockMasks csvBlockMasks(const char* p) {
+    const __m128i q = _mm_set1_epi8('"'), c = _mm_set1_epi8(','), nl = _mm_set1_epi8('\n');
+    __m128i v[4];
+    for (int i = 0; i < 4; ++i) v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+    auto bits = [&](__m128i needle) {
+        uint64_t r = 0;
+        for (int i = 0; i < 4; ++i)
+            r |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[i], needle)) << (16 * i);
+        return r;
+    };
+    return CsvBlockMasks{bits(q), bits(c), bits(nl)};
+}
+#elif defined(__ARM_NEON)
+inline CsvBlockMasks csvBlockMasks(const char* p) {
+    uint8x16_t v[4];
+    for (int i = 0; i < 4; ++i) v[i] = vld1q_u8(reinterpret_cast<const uint8_t*>(p + 16 * i));
+    // NEON has no movemask: AND each lane with its bit weight and add across
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t w = vld1q_u8(weights);
+    auto bits = [&](uint8_t ch) {
+        uint8x16_t needle = vdupq_n_u8(ch);
+        uint64_t r = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint8x16_t m = vandq_u8(vceqq_u8(v[i], needle), w);
+            uint64_t lo = vaddv_u8(vget_low_u8(m));
+            uint64_t hi = vaddv_u8(vget_high_u8(m));
+            r |= (lo | (hi << 8)) << (16 * i);
+        }
+        return r;
+    };
+    return CsvBlockMasks{bits('"'), bits(','), bits('\n')};
+}
+#else
+inline CsvBlockMasks csvBlockMasks(const char* p) { return csvBlockMasksScalar(p); }
+#endif
+
+// Bit i of the result is the XOR of bits 0..i: turns quote positions into a
+// mask of "inside quotes". An escaped "" flips twice, so it needs no special case.
+inline uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Write the offset of every comma/newline that sits outside quotes in
+// data[0, len) to `out` and return how many were found. Newlines are tagged
+// with CSV_END_OF_RECORD. `out` needs room for len entries and len < 2^31.
+// `inQuotes` carries the quote state from one call to the next.
+constexpr uint32_t CSV_END_OF_RECORD = 0x80000000u;
+
+inline size_t findCSVDelimiters(const char* data, size_t len, bool& inQuotes, uint32_t* out) {
+    uint64_t carry = inQuotes ? ~uint64_t(0) : 0;
+    uint32_t* w = out;
+    char tail[64];
+    for (size_t i = 0; i < len; i += 64) {
+        const char* block = data + i;
+        size_t n = len - i;
+        if (n < 64) {
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, block, n);
+            block = tail;
+        }
+        CsvBlockMasks m = csvBlockMasks(block);
+        uint64_t quoted = prefixXor(m.quote) ^ carry;
+        carry = (uint64_t)((int64_t)quoted >> 63);
+        uint64_t delims = (m.comma | m.newline) & ~quoted;
+        while (delims) {
+            uint32_t bit = (uint32_t)__builtin_ctzll(delims);
+            uint32_t eor = (uint32_t)((m.newline >> bit) & 1) << 31;
+            *w++ = ((uint32_t)i + bit) | eor;
+            delims &= delims - 1;
+        }
+    }
+    inQuotes = carry != 0;
+    return (size_t)(w - out);
+}
+
+// Number of '"' bytes in data[0, len), used to work out the quote state
+// at an arbitrary offset without tokenizing everything before it
+inline size_t countQuotes(const char* data, size_t len) {
+    size_t total = 0;
+    char tail[64];
+    for (size_t i = 0; i < len; i += 64) {
+        const char* block = data + i;
+        if (len - i < 64) {
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, block, len - i);
+            block = tail;
+        }
+        total += (size_t)__builtin_popcountll(csvBlockMasks(block).quote);
+    }
+    return total;
+}
+
+// First record boundary at or after `pos`, given whether `pos` is inside quotes
+inline size_t nextCSVRecordStart(std::string_view buf, size_t pos, bool inQuotes) {
+    for (; pos < buf.size(); ++pos) {
+        if (buf[pos] == '"') inQuotes = !inQuotes;
+        else if (buf[pos] == '\n' && !inQuotes) return pos + 1;
+    }
+    return buf.size();
+}
+
+// Turn the raw bytes between two delimiters into a CsvField
+inline CsvField makeCSVField(const char* p, size_t len) {
+    CsvField f;
+    if (len > 0 && p[len - 1] == '\r') --len;
+    if (len > 0 && p[0] == '"') {
+        // Closing quote is the last one; anything after it is dropped
+        size_t inner = len - 1;
+        while (inner > 0 && p[inner] != '"') --inner;
+        inner = inner == 0 ? len - 1 : inner - 1;
+        f.text = std::string_view(p + 1, inner);
+        f.escaped = std::memchr(p + 1, '"', inner) != nullptr;
+    } else {
+        f.text = std::string_view(p, len);
+    }
+    return f;
+}
+
+// Record-at-a-time reader over a whole buffer. Works 64 bytes at a time:
+// each block's quote/comma/newline masks give the delimiters outside
+// quotes, which are walked bit by bit, and a quoted field's closing quote
+// and any "" inside it are read off the same quote mask, so field bytes
+// are never scanned again. Fields that start in an earlier block (long
+// quoted names) go through makeCSVField instead.
+class CsvScanner {
+public:
+    explicit CsvScanner(std::string_view buffer, size_t start = 0)
+        : buf(buffer), scanned(start), fieldStart(start) {}
+
+    // Fill `fields` with the next record. Returns false once the buffer is used up.
+    bool nextRecord(std::vector<CsvField>& fields) {
+        fields.clear();
+        if (fieldStart >= buf.size()) return false;
+        while (true) {
+            while (delims == 0) {
+                if (!nextBlock()) {
+                    // Last record with no trailing newline
+                    fields.push_back(makeCSVField(buf.data() + fieldStart, buf.size() - fieldStart));
+                    fieldStart = buf.size();
+                    return true;
+                }
+            }
+            unsigned bit = (unsigned)__builtin_ctzll(delims);
+            delims &= delims - 1;
+            fields.push_back(field(bit));
+            fieldStart = blockAt + bit + 1;
+            if ((newlines >> bit) & 1) return true;
+        }
+    }
+
+    // Offset of the first byte not yet handed out
+    size_t position() const { return fieldStart; }
+
+private:
+    std::string_view buf;
+    size_t scanned;       // end of the blocks read so far
+    size_t fieldStart;
+    size_t blockAt = 0;   // offset of the current block
+    uint64_t quoteCarry = 0;   // all ones while inside quotes
+    uint64_t delims = 0;       // delimiters in the block not handed out yet
+    uint64_t newlines = 0;     // which of them end a record
+    uint64_t quotes = 0;       // '"' bytes in the block
+
+    bool nextBlock() {
+        if (scanned >= buf.size()) return false;
+        const char* block = buf.data() + scanned;
+        char tail[64];
+        if (buf.size() - scanned < 64) {
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, block, buf.size() - scanned);
+            block = tail;
+        }
+        CsvBlockMasks m = csvBlockMasks(block);
+        uint64_t quoted = prefixXor(m.quote) ^ quoteCarry;
+        quoteCarry = (uint64_t)((int64_t)quoted >> 63);
+        blockAt = scanned;
+        scanned += 64;
+        delims = (m.comma | m.newline) & ~quoted;
+        newlines = m.newline;
+        quotes = m.quote;
+        return true;
+    }
+
+    // The field from fieldStart up to the delimiter at bit `end` of the block
+    CsvField field(unsigned end) const {
+        const char* p = buf.data() + fieldStart;
+        size_t len = blockAt + end - fieldStart;
+        if (len > 0 && p[len - 1] == '\r') { --len; --end; }
+        if (len == 0 || p[0] != '"') return CsvField{std::string_view(p, len), false};
+        if (fieldStart < blockAt) return makeCSVField(p, len);
+        // Quotes after the opening one, up to the end of the field
+        unsigned open = (unsigned)(fieldStart - blockAt);
+        uint64_t inner = quotes & ~(((uint64_t)2 << open) - 1) & (((uint64_t)1 << end) - 1);
+        if (inner == 0) return CsvField{std::string_view(p + 1, len - 1), false};
+        unsigned close = 63 - (unsigned)__builtin_clzll(inner);
+        return CsvField{std::string_view(p + 1, close - open - 1), (inner & (((uint64_t)1 << close) - 1)) != 0};
+    }
+};
+
+// Split one line into unescaped fields (used for small files like users.csv)
+inline std::vector<std::string> splitCSVFields(std::string_view line) {
+    std::vector<std::string> cols;
+    std::vector<CsvField> fields;
+    CsvScanner scanner(line);
+    if (!scanner.nextRecord(fields)) fields.push_back(CsvField());
+    for (const CsvField& f : fields)
+        cols.push_back(f.escaped ? unescapeCSV(f.text) : std::string(f.text));
+    return cols;
+}
+
+#endif
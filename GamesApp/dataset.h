@@ -0,0 +1,207 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "bm25.h"
+#include "game_table.h"
+#include "metrics.h"
+#include "name_index.h"
+#include "rating_index.h"
+#include "recommend.h"
+#include "snapshot.h"
+#include "top.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define GAMES_HAVE_INOTIFY 1
+#endif
+
+// One loaded version of roblox_games.csv with everything derived from it.
+// A version never changes once published; readers keep a shared_ptr to
+// the one they started with, so a reload can't pull rows out from under
+// a query that is still running.
+struct Dataset {
+    GameTable table;
+    std::string header;
+    NameIndex names;
+    RelevanceIndex relevance;   // word search ranked by BM25 + popularity
+    RatingIndex ratings;
+    Recommender recommender;
+    TopIndex tops;   // leaderboard cache, filled on demand
+    uint64_t version = 0;
+};
+
+inline std::shared_ptr<Dataset> loadDataset(const std::string& csvPath, uint64_t version = 1) {
+    auto d = std::make_shared<Dataset>();
+    if (!loadGamesCached(csvPath, d->table, d->header, d->names, d->ratings)) return nullptr;
+    // Big catalogs use LSH buckets so recommending doesn't scan every game
+    d->recommender.build(d->table, d->table.size() > 100000);
+    d->relevance.build(d->table);
+    d->version = version;
+    return d;
+}
+
+// How a new version differs from the old one. Rows are matched by their
+// trimmed, case-folded name; rows sharing a name pair up in file order.
+// A matched row counts as changed when its rank or any stat moved.
+struct DatasetDiff {
+    size_t added = 0;
+    size_t removed = 0;
+    size_t changed = 0;
+    bool empty() const { return added == 0 && removed == 0 && changed == 0; }
+};
+
+inline DatasetDiff diffTables(const GameTable& before, const GameTable& after) {
+    // Each name's old rows in file order, and how many are paired off
+    std::unordered_map<std::string_view, std::pair<std::vector<size_t>, size_t>> old;
+    old.reserve(before.size());
+    for (size_t i = 0; i < before.size(); ++i) old[before.key(i)].first.push_back(i);
+
+    DatasetDiff d;
+    size_t matched = 0;
+    for (size_t j = 0; j < after.size(); ++j) {
+        auto it = old.find(after.key(j));
+        if (it == old.end() || it->second.second == it->second.first.size()) { ++d.added; continue; }
+        size_t i = it->second.first[it->second.second++];
+        ++matched;
+        bool same = before.rank[i] == after.rank[j] &&
+                    before.active[i] == after.active[j] && before.visits[i] == after.visits[j] &&
+                    before.favourites[i] == after.favourites[j] && before.likes[i] == after.likes[j] &&
+                    before.dislikes[i] == after.dislikes[j] &&
+                    (before.rating[i] == after.rating[j] ||
+                     (std::isnan(before.rating[i]) && std::isnan(after.rating[j])));
+        if (!same) ++d.changed;
+    }
+    d.removed = before.size() - matched;
+    return d;
+}
+
+// Watches the CSV and reloads it in the background when it changes.
+// Uses inotify where there is one and polls size + mtime elsewhere. The
+// new version is parsed, indexed and diffed off to the side, then
+// published with one atomic pointer swap.
+class DatasetWatcher {
+public:
+    ~DatasetWatcher() { stop(); }
+
+    void start(const std::string& csv, std::shared_ptr<const Dataset> initial) {
+        stop();
+        csvPath = csv;
+        std::atomic_store(&live, std::move(initial));
+        stopping = false;
+        worker = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        stopping = true;
+        if (worker.joinable()) worker.join();
+    }
+
+    std::shared_ptr<const Dataset> current() const { return std::atomic_load(&live); }
+
+    // What the most recent reload changed
+    DatasetDiff lastDiff() const {
+        std::lock_guard<std::mutex> lock(diffMutex);
+        return diff;
+    }
+
+private:
+    std::string csvPath;
+    std::shared_ptr<const Dataset> live;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+    mutable std::mutex diffMutex;
+    DatasetDiff diff;
+
+    // Editors and exporters often write in several bursts; wait for the
+    // file to go quiet before reading it
+    static constexpr int SETTLE_MS = 300;
+    static constexpr int POLL_MS = 1000;
+
+    void reload() {
+        ScopedOp timed(OP_RELOAD);
+        std::shared_ptr<const Dataset> old = current();
+        std::shared_ptr<Dataset> next = loadDataset(csvPath, old ? old->version + 1 : 1);
+        if (!next) return;   // mid-write or gone; the next change event retries
+        DatasetDiff d = old ? diffTables(old->table, next->table) : DatasetDiff{next->table.size(), 0, 0};
+        if (old && d.empty()) return;   // touched but not changed
+        {
+            std::lock_guard<std::mutex> lock(diffMutex);
+            diff = d;
+        }
+        std::atomic_store(&live, std::shared_ptr<const Dataset>(std::move(next)));
+    }
+
+    void run() {
+#ifdef GAMES_HAVE_INOTIFY
+        if (runInotify()) return;
+#endif
+        runPolling();
+    }
+
+    void runPolling() {
+        auto stamp = [&] {
+            std::error_code ec;
+            auto size = std::filesystem::file_size(csvPath, ec);
+            auto mtime = std::filesystem::last_write_time(csvPath, ec);
+            return std::make_pair(ec ? 0 : (uint64_t)size, ec ? 0 : (int64_t)mtime.time_since_epoch().count());
+        };
+        auto seen = stamp();
+        while (!stopping) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+            auto now = stamp();
+            if (now == seen) continue;
+            std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_MS));
+            seen = stamp();
+            reload();
+        }
+    }
+
+#ifdef GAMES_HAVE_INOTIFY
+    // Watch the directory rather than the file, so a dump that is written
+    // elsewhere and renamed into place is seen too
+    bool runInotify() {
+        std::filesystem::path p(csvPath);
+        std::string dir = p.has_parent_path() ? p.parent_path().string() : ".";
+        std::string file = p.filename().string();
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return false;
+        if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MODIFY) < 0) {
+            ::close(fd);
+            return false;
+        }
+        alignas(inotify_event) char buf[4096];
+        bool pending = false;
+        while (!stopping) {
+            pollfd pfd{fd, POLLIN, 0};
+            // Short timeout so stop() is noticed; while a change is pending
+            // it doubles as the settle delay
+            int ready = ::poll(&pfd, 1, pending ? SETTLE_MS : 200);
+            if (ready == 0) {
+                if (pending) { pending = false; reload(); }
+                continue;
+            }
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            for (ssize_t off = 0; n > 0 && off < n;) {
+                const inotify_event* e = reinterpret_cast<const inotify_event*>(buf + off);
+                if (e->len > 0 && file == e->name) pending = true;
+                off += (ssize_t)(sizeof(inotify_event) + e->len);
+            }
+        }
+        ::close(fd);
+        return true;
+    }
+#endif
+};
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef FAVORITES_H
+#define FAVORITES_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "csv.h"
+#include "game_table.h"
+#include "mapped_file.h"
+#include "metrics.h"
+
+// A favorites file is an append-only log. An add is the game's full CSV
+// row (so it starts with "#rank,name"), and a remove is the same row
+// prefixed with '-'. Logs from before removes carried the row have just
+// "-#rank", which refers to the earlier add with that rank.
+// Files written before the log existed are just a list of adds.
+// Calls onAdd(name, rank, line) / onRemove(name, rank, line) for each
+// record in order, line being the record as written without its '-' or
+// line break; name is empty for the old short removes.
+template <class Add, class Remove>
+inline void replayFavoritesLog(std::string_view data, Add onAdd, Remove onRemove) {
+    CsvScanner scanner(data);
+    std::vector<CsvField> f;
+    std::string name;
+    size_t start = scanner.position();
+    while (scanner.nextRecord(f)) {
+        std::string_view line = data.substr(start, scanner.position() - start);
+        start = scanner.position();
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.remove_suffix(1);
+        std::string_view key = f[0].text;
+        bool removal = !key.empty() && key[0] == '-';
+        if (removal) { key.remove_prefix(1); line.remove_prefix(1); }
+        if (key.empty() || key[0] != '#') continue;
+        int64_t rank = 0;
+        if (!parseCount(key.substr(1), rank)) continue;
+        name.clear();
+        if (f.size() > 1) name = f[1].escaped ? unescapeCSV(f[1].text) : std::string(f[1].text);
+        if (!removal && name.empty()) continue;
+        if (removal) onRemove(name, (int32_t)rank, line);
+        else onAdd(name, (int32_t)rank, line);
+    }
+}
+
+// Finds logged games in a table by key (see GameTable::key). A name listed
+// more than once resolves to the row whose rank is closest to the logged
+// one, so the duplicate listings in a dump stay one game.
+class FavoriteResolver {
+public:
+    // Every game in `t`
+    explicit FavoriteResolver(const GameTable& t) : table(t) {
+        for (size_t i = 0; i < t.size(); ++i) candidates[t.key(i)].push_back(i);
+    }
+
+    // Only the games whose key is one of `keys`
+    FavoriteResolver(const GameTable& t, const std::vector<std::string_view>& keys) : table(t) {
+        for (std::string_view k : keys) candidates.emplace(k, std::vector<size_t>());
+        if (candidates.empty()) return;
+        for (size_t i = 0; i < t.size(); ++i) {
+            auto it = candidates.find(t.key(i));
+            if (it != candidates.end()) it->second.push_back(i);
+        }
+    }
+
+    bool find(std::string_view key, int32_t rank, size_t& row) const {
+        auto it = candidates.find(key);
+        if (it == candidates.end() || it->second.empty()) return false;
+        int64_t best = INT64_MAX;
+        for (size_t i : it->second) {
+            int64_t gap = std::llabs((int64_t)table.rank[i] - rank);
+            if (gap < best) { best = gap; row = i; }
+        }
+        return true;
+    }
+
+private:
+    const GameTable& table;
+    std::unordered_map<std::string_view, std::vector<size_t>> candidates;
+};
+
+// One user's favorites, keyed by game (folded name) with the rank it had
+// when it was added to pick between duplicate names. Loaded from the log
+// at login; every change is a single appended line, and the log is
+// rewritten only when dead records start to outnumber live ones.
+// A favorite whose game isn't in the bound table (it fell out of today's
+// dump, or a reload caught a half-written file) is kept with its last
+// logged row: hidden from rows(), but written back on compaction and
+// shown again once a table has it.
+class FavoritesStore {
+public:
+    bool open(const std::string& logPath, const GameTable& games) {
+        path = logPath;
+        favorites.clear();
+        members.clear();
+
+        logRecords = 0;
+        MappedFile file;
+        if (file.open(path)) {
+            replayFavoritesLog(file.view(),
+                [&](const std::string& name, int32_t r, std::string_view line) {
+                    ++logRecords;
+                    if (insert(GameTable::keyOf(name), r)) favorites.back().line = line;
+                },
+                [&](const std::string& name, int32_t r, std::string_view) { ++logRecords; erase(name, r); });
+        }
+        file.close();
+        rebind(games);
+        if (needsCompaction()) compact();
+        log.open(path, std::ios::app);
+        return (bool)log;
+    }
+
+    // Point at a reloaded table. Each favorite is found again by name, so
+    // it follows its game to a new rank; games no longer in the dataset
+    // are kept but hidden until they come back.
+    void rebind(const GameTable& games) {
+        table = &games;
+        rowByRank.clear();
+        for (size_t i = 0; i < games.size(); ++i) rowByRank.emplace(games.rank[i], i);
+
+        std::vector<std::string_view> keys;
+        for (const Favorite& f : favorites) keys.push_back(f.key);
+        FavoriteResolver resolver(games, keys);
+        live = 0;
+        for (Favorite& f : favorites) {
+            f.resolved = resolver.find(f.key, f.rank, f.row);
+            if (!f.resolved) continue;
+            f.rank = games.rank[f.row];
+            f.line.clear();
+            games.appendRow(f.line, f.row);
+            ++live;
+        }
+    }
+
+    // Row of the game with this rank in the bound table
+    bool rowOf(int32_t rank, size_t& row) const {
+        auto it = rowByRank.find(rank);
+        if (it == rowByRank.end()) return false;
+        row = it->second;
+        return true;
+    }
+
+    // Favorites in the bound table; missing() more are waiting for theirs
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+    size_t missing() const { return favorites.size() - live; }
+
+    // Table rows for the favorites, in the order they were added
+    std::vector<size_t> rows() const {
+        metrics::addRows(favorites.size());
+        std::vector<size_t> out;
+        out.reserve(live);
+        for (const Favorite& f : favorites)
+            if (f.resolved) out.push_back(f.row);
+        return out;
+    }
+
+    bool add(size_t row) {
+        std::string key(table->key(row));
+        if (!insert(key, table->rank[row])) return false;
+        Favorite& f = favorites.back();
+        f.row = row;
+        f.resolved = true;
+        table->appendRow(f.line, row);
+        ++live;
+        log << f.line << '\n';
+        log.flush();
+        ++logRecords;
+        if (needsCompaction()) compact();
+        return true;
+    }
+
+    bool remove(size_t row) {
+        if (members.erase(std::string(table->key(row))) == 0) return false;
+        std::string_view key = table->key(row);
+        for (size_t i = 0; i < favorites.size(); ++i) {
+            if (favorites[i].key == key) {
+                if (favorites[i].resolved) --live;
+                favorites.erase(favorites.begin() + (std::ptrdiff_t)i);
+                break;
+            }
+        }
+        log << '-';
+        table->writeRow(log, row);
+        log << '\n';
+        log.flush();
+        ++logRecords;
+        if (needsCompaction()) compact();
+        return true;
+    }
+
+    // Rewrite the log with one line per favorite, hidden ones included.
+    // Written to a temp file and renamed over the old one so a crash never
+    // loses the list; if either step fails the old log stays in use.
+    bool compact() {
+        if (log.is_open()) log.close();
+        std::string tmp = path + ".tmp";
+        bool ok;
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            for (const Favorite& f : favorites) out << f.line << '\n';
+            out.close();
+            ok = !out.fail();
+        }
+        ok = ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+        if (ok) logRecords = favorites.size();
+        else std::remove(tmp.c_str());
+        log.open(path, std::ios::app);
+        return ok;
+    }
+
+private:
+    struct Favorite {
+        std::string key;    // GameTable::key of the game
+        int32_t rank;       // as logged, then as of the bound table
+        size_t row = 0;
+        bool resolved = false;   // row is valid in the bound table
+        std::string line;   // the row as last logged or seen, for compaction
+    };
+
+    std::string path;
+    const GameTable* table = nullptr;
+    std::vector<Favorite> favorites;         // insertion order
+    size_t live = 0;                         // how many are resolved
+    std::unordered_set<std::string> members; // their keys
+    std::unordered_map<int32_t, size_t> rowByRank;
+    std::ofstream log;
+    size_t logRecords = 0;
+
+    bool needsCompaction() const {
+        return logRecords > 64 && logRecords > 2 * favorites.size();
+    }
+
+    bool insert(const std::string& key, int32_t rank) {
+        if (key.empty() || !members.insert(key).second) return false;
+        favorites.push_back({key, rank, 0, false, std::string()});
+        return true;
+    }
+
+    // A logged remove: by name, or for old short records by the rank the
+    // game was added with
+    void erase(const std::string& name, int32_t rank) {
+        std::string key = name.empty() ? std::string() : GameTable::keyOf(name);
+        for (size_t i = 0; i < favorites.size(); ++i) {
+            if (name.empty() ? favorites[i].rank == rank : favorites[i].key == key) {
+                members.erase(favorites[i].key);
+                if (favorites[i].resolved) --live;
+                favorites.erase(favorites.begin() + (std::ptrdiff_t)i);
+                return;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,417 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "case_fold.h"
+#include "game_table.h"
+#include "metrics.h"
+#include "name_index.h"
+
+// Filter expressions over the games table, e.g.
+//   rating >= 90 and active > 100k and name ~ "tycoon"
+//   (visits > 1b or favourites >= 10m) and not name ~ "obby"
+//
+// Grammar (keywords and column names are case-insensitive):
+//   expr    := term ("or" term)*
+//   term    := factor ("and" factor)*
+//   factor  := "not" factor | "(" expr ")" | compare
+//   compare := column op number        op: < <= > >= = == !=
+//            | "name" ("~" | "=" | "!=") "text"
+//   numbers may use thousands commas and a k / m / b suffix
+//
+// compile() turns the parse tree into kernels. run() then streams the
+// table through them BATCH rows at a time. Each kernel narrows a
+// selection vector (the row ids still alive in the batch), so an "and"
+// chain only looks at rows that passed the earlier tests, and every
+// column is read once per batch while it is still in cache.
+class FilterExpr {
+public:
+    static const size_t BATCH = 1024;
+
+    // Parse and compile `text` against the table. On failure returns false
+    // and says what went wrong in error.
+    bool compile(const std::string& text, const GameTable& t, const NameIndex& names, std::string& error) {
+        table = &t;
+        src = text;
+        pos = 0;
+        root.reset();
+        err.clear();
+        std::unique_ptr<Node> n = parseOr(names);
+        skipSpace();
+        if (n && pos < src.size()) fail("unexpected '" + src.substr(pos, 12) + "'");
+        if (!err.empty()) {
+            error = err;
+            return false;
+        }
+        root = std::move(n);
+        allocate(*root);
+        return true;
+    }
+
+    // Matching rows in file order. Names starting with '#' are left out
+    // like the other menus do.
+    std::vector<size_t> run() {
+        std::vector<size_t> out;
+        if (!root) return out;
+        metrics::addRows(table->size());
+        for (size_t begin = 0; begin < table->size(); begin += BATCH) {
+            Selection all{nullptr, std::min(BATCH, table->size() - begin), (uint32_t)begin};
+            Selection keep = eval(*root, all);
+            for (size_t k = 0; k < keep.count; ++k) {
+                size_t row = keep.at(k);
+                if (table->listed(row)) out.push_back(row);
+            }
+        }
+        return out;
+    }
+
+private:
+    enum Kind { AND, OR, NOT, COMPARE, NAME_MATCH };
+    enum Op { LT, LE, GT, GE, EQ, NE };
+
+    struct Node {
+        Kind kind;
+        std::vector<std::unique_ptr<Node>> kids;
+        GameColumn column = COL_RANK;
+        Op op = EQ;
+        double value = 0;
+        bool negate = false;              // NAME_MATCH with !=
+        std::vector<uint64_t> bits;       // NAME_MATCH: rows that match
+        std::vector<uint32_t> buf, tmp;   // this node's output selections
+    };
+
+    // Rows alive in one batch: explicit ids, or the dense run
+    // [first, first + count) when ids is null
+    struct Selection {
+        const uint32_t* ids;
+        size_t count;
+        uint32_t first;
+        uint32_t at(size_t k) const { return ids ? ids[k] : first + (uint32_t)k; }
+    };
+
+    const GameTable* table = nullptr;
+    std::unique_ptr<Node> root;
+    std::string src, err;
+    size_t pos = 0;
+
+    // --- Parser ---
+
+    void fail(const std::string& message) {
+        if (err.empty()) err = message;
+    }
+
+    void skipSpace() {
+        while (pos < src.size() && std::isspace((unsigned char)src[pos])) ++pos;
+    }
+
+    // Consume keyword `word` if it is next (and not the prefix of a longer word)
+    bool keyword(const char* word) {
+        skipSpace();
+        size_t n = std::char_traits<char>::length(word);
+        if (src.size() - pos < n) return false;
+        for (size_t i = 0; i < n; ++i)
+            if (std::tolower((unsigned char)src[pos + i]) != word[i]) return false;
+        if (pos + n < src.size() && (std::isalnum((unsigned char)src[pos + n]) || src[pos + n] == '_')) return false;
+        pos += n;
+        return true;
+    }
+
+    std::unique_ptr<Node> combine(Kind kind, std::unique_ptr<Node> first) {
+        auto n = std::make_unique<Node>();
+        n->kind = kind;
+        n->kids.push_back(std::move(first));
+        return n;
+    }
+
+    std::unique_ptr<Node> parseOr(const NameIndex& names) {
+        std::unique_ptr<Node> left = parseAnd(names);
+        if (!left || !keyword("or")) return left;
+        auto n = combine(OR, std::move(left));
+        do {
+            std::unique_ptr<Node> right = parseAnd(names);
+            if (!right) return nullptr;
+            n->kids.push_back(std::move(right));
+        } while (keyword("or"));
+        return n;
+    }
+
+    std::unique_ptr<Node> parseAnd(const NameIndex& names) {
+        std::unique_ptr<Node> left = parseFactor(names);
+        if (!left || !keyword("and")) return left;
+        auto n = combine(AND, std::move(left));
+        do {
+            std::unique_ptr<Node> right = parseFactor(names);
+            if (!right) return nullptr;
+            n->kids.push_back(std::move(right));
+        } while (keyword("and"));
+        return n;
+    }
+
+    std::unique_ptr<Node> parseFactor(const NameIndex& names) {
+        if (keyword("not")) {
+            std::unique_ptr<Node> inner = parseFactor(names);
+            return inner ? combine(NOT, std::move(inner)) : nullptr;
+        }
+        skipSpace();
+        if (pos < src.size() && src[pos] == '(') {
+            ++pos;
+            std::unique_ptr<Node> inner = parseOr(names);
+            skipSpace();
+            if (!inner) return nullptr;
+            if (pos >= src.size() || src[pos] != ')') { fail("missing ')'"); return nullptr; }
+            ++pos;
+            return inner;
+        }
+        return parseCompare(names);
+    }
+
+    std::unique_ptr<Node> parseCompare(const NameIndex& names) {
+        skipSpace();
+        size_t start = pos;
+        while (pos < src.size() && (std::isalpha((unsigned char)src[pos]) || src[pos] == '_')) ++pos;
+        std::string word = src.substr(start, pos - start);
+        GameColumn column;
+        if (word.empty()) { fail("expected a column name at '" + src.substr(start, 12) + "'"); return nullptr; }
+        if (!parseColumnName(word, column)) { fail("unknown column '" + word + "'"); return nullptr; }
+
+        skipSpace();
+        static const struct { const char* text; Op op; } ops[] = {
+            {"<=", LE}, {">=", GE}, {"==", EQ}, {"!=", NE}, {"<", LT}, {">", GT}, {"=", EQ}};
+        auto n = std::make_unique<Node>();
+        bool contains = false, matched = false;
+        if (pos < src.size() && src[pos] == '~') {
+            ++pos;
+            contains = matched = true;
+        }
+        for (const auto& o : ops) {
+            if (matched) break;
+            if (src.compare(pos, std::char_traits<char>::length(o.text), o.text) == 0) {
+                n->op = o.op;
+                pos += std::char_traits<char>::length(o.text);
+                matched = true;
+            }
+        }
+        if (!matched) { fail("expected a comparison after '" + word + "'"); return nullptr; }
+
+        if (column == COL_NAME) {
+            if (!contains && n->op != EQ && n->op != NE) { fail("names only support ~, = and !="); return nullptr; }
+            std::string text;
+            if (!parseString(text)) return nullptr;
+            n->kind = NAME_MATCH;
+            n->negate = !contains && n->op == NE;
+            buildNameBits(*n, text, contains, names);
+            return n;
+        }
+        if (contains) { fail("~ only works on name"); return nullptr; }
+        n->kind = COMPARE;
+        n->column = column;
+        return parseNumber(n->value) ? std::move(n) : nullptr;
+    }
+
+    bool parseString(std::string& out) {
+        skipSpace();
+        if (pos >= src.size() || (src[pos] != '"' && src[pos] != '\'')) {
+            // Allow a bare word too: name ~ tycoon
+            size_t start = pos;
+            while (pos < src.size() && !std::isspace((unsigned char)src[pos]) && src[pos] != ')') ++pos;
+            out = src.substr(start, pos - start);
+            if (out.empty()) fail("expected text after the comparison");
+            return !out.empty();
+        }
+        char quote = src[pos++];
+        size_t end = src.find(quote, pos);
+        if (end == std::string::npos) { fail("unterminated string"); return false; }
+        out = src.substr(pos, end - pos);
+        pos = end + 1;
+        return true;
+    }
+
+    bool parseNumber(double& out) {
+        skipSpace();
+        std::string digits;
+        size_t start = pos;
+        while (pos < src.size() && (std::isdigit((unsigned char)src[pos]) || src[pos] == '.' || src[pos] == '-' ||
+                                    (src[pos] == ',' && pos + 1 < src.size() && std::isdigit((unsigned char)src[pos + 1])))) {
+            if (src[pos] != ',') digits += src[pos];
+            ++pos;
+        }
+        char* end = nullptr;
+        out = std::strtod(digits.c_str(), &end);
+        if (digits.empty() || *end != '\0') { fail("expected a number at '" + src.substr(start, 12) + "'"); return false; }
+        if (pos < src.size()) {
+            char s = (char)std::tolower((unsigned char)src[pos]);
+            double scale = s == 'k' ? 1e3 : s == 'm' ? 1e6 : s == 'b' ? 1e9 : 0;
+            if (scale > 0 && (pos + 1 >= src.size() || !std::isalnum((unsigned char)src[pos + 1]))) {
+                out *= scale;
+                ++pos;
+            }
+        }
+        return true;
+    }
+
+    // Name tests are resolved once at compile time into a row bitmap, using
+    // the trigram index for "contains", so the kernel is a bit test
+    void buildNameBits(Node& n, const std::string& text, bool contains, const NameIndex& names) {
+        n.bits.assign((table->size() + 63) / 64, 0);
+        auto set = [&](size_t row) { n.bits[row >> 6] |= uint64_t(1) << (row & 63); };
+        if (contains) {
+            for (size_t row : names.search(text)) set(row);
+        } else {
+            // Same key favorites use, so stray blanks around a name don't matter
+            std::string key = GameTable::keyOf(text);
+            for (size_t row = 0; row < table->size(); ++row)
+                if (table->key(row) == key) set(row);
+        }
+    }
+
+    // --- Execution ---
+
+    void allocate(Node& n) {
+        n.buf.resize(BATCH);
+        if (n.kind == OR) n.tmp.resize(BATCH);
+        for (auto& k : n.kids) allocate(*k);
+    }
+
+    // Predicate kernel: keep the selected rows where pred(row) holds.
+    // Written branch-free so the compiler can keep it in registers.
+    template <class Pred>
+    static size_t select(const Selection& in, uint32_t* out, Pred pred) {
+        size_t n = 0;
+        if (in.ids) {
+            for (size_t k = 0; k < in.count; ++k) {
+                uint32_t row = in.ids[k];
+                out[n] = row;
+                n += pred(row);
+            }
+        } else {
+            for (uint32_t row = in.first, end = in.first + (uint32_t)in.count; row < end; ++row) {
+                out[n] = row;
+                n += pred(row);
+            }
+        }
+        return n;
+    }
+
+    template <class T>
+    static size_t compareColumn(const T* col, Op op, T v, const Selection& in, uint32_t* out) {
+        switch (op) {
+        case LT: return select(in, out, [&](uint32_t r) { return col[r] < v; });
+        case LE: return select(in, out, [&](uint32_t r) { return col[r] <= v; });
+        case GT: return select(in, out, [&](uint32_t r) { return col[r] > v; });
+        case GE: return select(in, out, [&](uint32_t r) { return col[r] >= v; });
+        case EQ: return select(in, out, [&](uint32_t r) { return col[r] == v; });
+        case NE: return select(in, out, [&](uint32_t r) { return col[r] != v; });
+        }
+        return 0;
+    }
+
+    size_t compare(const Node& n, const Selection& in, uint32_t* out) const {
+        const GameTable& t = *table;
+        // Integer columns compare against the value rounded the way the
+        // operator needs, so "> 99.5" on a count means ">= 100"
+        auto intValue = [&] {
+            double v = n.value;
+            if (n.op == GT || n.op == LE) v = std::floor(v);
+            else if (n.op == GE || n.op == LT) v = std::ceil(v);
+            return v;
+        };
+        switch (n.column) {
+        case COL_RANK: {
+            double v = intValue();
+            if (v != std::floor(n.value) && (n.op == EQ || n.op == NE)) return n.op == NE ? copy(in, out) : 0;
+            return compareColumn(t.rank.data(), n.op, (int32_t)std::max(-2147483648.0, std::min(2147483647.0, v)), in, out);
+        }
+        case COL_RATING: {
+            // A blank rating is NaN, which != would otherwise match
+            if (n.op == NE) {
+                const float* col = t.rating.data();
+                float v = (float)n.value;
+                return select(in, out, [&](uint32_t r) { return col[r] != v && col[r] == col[r]; });
+            }
+            return compareColumn(t.rating.data(), n.op, (float)n.value, in, out);
+        }
+        default: {
+            const std::vector<int64_t>* cols[] = {nullptr, nullptr, &t.active, &t.visits, &t.favourites, &t.likes, &t.dislikes};
+            double v = intValue();
+            if (v != n.value && (n.op == EQ || n.op == NE)) return n.op == NE ? copy(in, out) : 0;
+            v = std::max(-9.2e18, std::min(9.2e18, v));
+            return compareColumn(cols[n.column]->data(), n.op, (int64_t)v, in, out);
+        }
+        }
+    }
+
+    static size_t copy(const Selection& in, uint32_t* out) {
+        for (size_t k = 0; k < in.count; ++k) out[k] = in.at(k);
+        return in.count;
+    }
+
+    // Rows of `in` that are not in the sorted list `drop`
+    static size_t subtract(const Selection& in, const uint32_t* drop, size_t dropCount, uint32_t* out) {
+        size_t n = 0, d = 0;
+        for (size_t k = 0; k < in.count; ++k) {
+            uint32_t row = in.at(k);
+            while (d < dropCount && drop[d] < row) ++d;
+            if (d < dropCount && drop[d] == row) continue;
+            out[n++] = row;
+        }
+        return n;
+    }
+
+    Selection eval(Node& n, Selection in) {
+        switch (n.kind) {
+        case COMPARE:
+            return {n.buf.data(), compare(n, in, n.buf.data()), 0};
+        case NAME_MATCH: {
+            const uint64_t* bits = n.bits.data();
+            bool neg = n.negate;
+            size_t count = select(in, n.buf.data(), [&](uint32_t r) { return (((bits[r >> 6] >> (r & 63)) & 1) != 0) != neg; });
+            return {n.buf.data(), count, 0};
+        }
+        case AND: {
+            // Each test only sees what the previous ones let through
+            Selection cur = in;
+            for (auto& k : n.kids) {
+                if (cur.count == 0) break;
+                cur = eval(*k, cur);
+            }
+            return cur;
+        }
+        case OR: {
+            // Later branches only test rows no earlier branch accepted;
+            // the accepted sets are disjoint and merged back in row order
+            size_t have = 0;
+            Selection rest = in;
+            for (auto& k : n.kids) {
+                if (rest.count == 0) break;
+                Selection got = eval(*k, rest);
+                size_t merged = 0, a = 0, b = 0;
+                uint32_t* dst = n.tmp.data();
+                while (a < have || b < got.count) {
+                    if (b == got.count || (a < have && n.buf[a] < got.at(b))) dst[merged++] = n.buf[a++];
+                    else dst[merged++] = got.at(b++);
+                }
+                n.buf.swap(n.tmp);
+                have = merged;
+                // The rest is everything in `in` not yet accepted; kept in tmp
+                size_t left = subtract(in, n.buf.data(), have, n.tmp.data());
+                rest = {n.tmp.data(), left, 0};
+            }
+            return {n.buf.data(), have, 0};
+        }
+        case NOT: {
+            Selection got = eval(*n.kids[0], in);
+            return {n.buf.data(), subtract(in, got.ids, got.count, n.buf.data()), 0};
+        }
+        }
+        return in;
+    }
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <cstdint>
+#include <string_view>
+
+// Myers' bit-parallel edit distance (J. ACM 1999) for a pattern of up to
+// 64 bytes. One column of the dynamic-programming matrix lives in two
+// 64-bit words, so each text byte costs a handful of ALU ops regardless
+// of the pattern length.
+class MyersPattern {
+public:
+    static const size_t MAX_LENGTH = 64;
+
+    // Longer patterns are cut to MAX_LENGTH bytes
+    explicit MyersPattern(std::string_view pattern) {
+        length = pattern.size() < MAX_LENGTH ? pattern.size() : MAX_LENGTH;
+        for (uint64_t& m : peq) m = 0;
+        for (size_t i = 0; i < length; ++i) peq[(unsigned char)pattern[i]] |= uint64_t(1) << i;
+    }
+
+    size_t size() const { return length; }
+
+    // Fewest edits that turn the pattern into some substring of `text`
+    // (an approximate "contains"). Stops early once it hits 0.
+    int bestDistance(std::string_view text) const {
+        if (length == 0) return 0;
+        const uint64_t high = uint64_t(1) << (length - 1);
+        uint64_t pv = length == 64 ? ~uint64_t(0) : (high << 1) - 1;
+        uint64_t mv = 0;
+        int score = (int)length, best = score;
+        for (char ch : text) {
+            uint64_t eq = peq[(unsigned char)ch];
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+            if (ph & high) ++score;
+            else if (mh & high) --score;
+            // Text position 0 costs nothing to skip, so no carry-in bit:
+            // the match may start anywhere in the text
+            ph <<= 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+            if (score < best) {
+                best = score;
+                if (best == 0) break;
+            }
+        }
+        return best;
+    }
+
+private:
+    uint64_t peq[256];   // bit i set where pattern[i] is that byte
+    size_t length = 0;
+};
+
+#endif
@@ -0,0 +1,511 @@
+#ifndef GAME_TABLE_H
+#define GAME_TABLE_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "case_fold.h"
+#include "count_parse.h"
+#include "csv.h"
+#include "mapped_file.h"
+#include "utils.h"
+
+// Column indexes in roblox_games.csv
+enum GameColumn {
+    COL_RANK = 0, COL_NAME, COL_ACTIVE, COL_VISITS, COL_FAVOURITES,
+    COL_LIKES, COL_DISLIKES, COL_RATING, GAME_COLUMN_COUNT
+};
+
+// Lower-case column names, as typed in queries
+const char* const COLUMN_NAMES[GAME_COLUMN_COUNT] = {
+    "rank", "name", "active", "visits", "favourites", "likes", "dislikes", "rating"};
+
+// Column for a name typed in a query ("visits", "Favorites", ...)
+inline bool parseColumnName(std::string_view s, GameColumn& out) {
+    std::string key = foldCase(s);
+    if (key == "favorites") key = "favourites";
+    for (int c = 0; c < GAME_COLUMN_COUNT; ++c) {
+        if (key == COLUMN_NAMES[c]) { out = (GameColumn)c; return true; }
+    }
+    return false;
+}
+
+// Parse a rating like "92.64" or "86.5" without going through stod
+inline bool parseRating(std::string_view s, float& out) {
+    double whole = 0, frac = 0, scale = 1;
+    bool any = false, dot = false;
+    for (char c : s) {
+        if (c >= '0' && c <= '9') {
+            if (dot) { scale /= 10; frac += (c - '0') * scale; }
+            else whole = whole * 10 + (c - '0');
+            any = true;
+        } else if (c == '.' && !dot) {
+            dot = true;
+        } else if (c != ' ' && c != '\r') {
+            return false;
+        }
+    }
+    out = any ? (float)(whole + frac) : NAN;
+    return any;
+}
+
+// Cells the loader couldn't read. They load as 0 (NaN for ratings) like
+// before, but are counted here instead of passing silently. Blank cells
+// are normal in the dumps and aren't counted.
+struct LoadIssues {
+    static const size_t MAX_EXAMPLES = 5;
+
+    uint64_t malformed = 0;
+    uint64_t overflowed = 0;
+    std::vector<std::string> examples;   // e.g. "#123 visits: \"12a\" (malformed)"
+
+    bool empty() const { return malformed == 0 && overflowed == 0; }
+
+    void note(std::string_view rank, const char* column, std::string_view cell, const char* what) {
+        if (examples.size() >= MAX_EXAMPLES) return;
+        std::string e = "#";
+        e.append(rank.data(), rank.size());
+        e += ' ';
+        e += column;
+        e += ": \"";
+        e.append(cell.data(), std::min<size_t>(cell.size(), 40));
+        e += "\" (";
+        e += what;
+        e += ')';
+        examples.push_back(std::move(e));
+    }
+
+    void merge(const LoadIssues& o) {
+        malformed += o.malformed;
+        overflowed += o.overflowed;
+        for (const std::string& e : o.examples)
+            if (examples.size() < MAX_EXAMPLES) examples.push_back(e);
+    }
+
+    std::string summary() const {
+        return std::to_string(malformed) + " malformed and " + std::to_string(overflowed) +
+               " out-of-range numeric cells, loaded as 0 (ratings as blank)";
+    }
+};
+
+// Typed, column-oriented copy of the games dataset.
+// Everything is parsed once at load so queries only touch numeric arrays.
+// Names are not copied: they point into the mapped CSV, and only names that
+// needed unescaping get their own copy in nameHeap.
+class GameTable {
+public:
+    GameTable() = default;
+    GameTable(GameTable&&) = default;
+    GameTable& operator=(GameTable&&) = default;
+    GameTable(const GameTable&) = delete;
+    GameTable& operator=(const GameTable&) = delete;
+
+    std::vector<int32_t> rank;
+    std::vector<int64_t> active;
+    std::vector<int64_t> visits;
+    std::vector<int64_t> favourites;
+    std::vector<int64_t> likes;
+    std::vector<int64_t> dislikes;
+    std::vector<float> rating;   // NaN when the cell was missing
+    LoadIssues issues;           // cells that didn't parse
+
+    size_t size() const { return rank.size(); }
+
+    // Any numeric column as a double, for generic sorting and filtering.
+    // NaN for COL_NAME and for missing ratings.
+    double value(GameColumn c, size_t i) const {
+        switch (c) {
+        case COL_RANK: return rank[i];
+        case COL_ACTIVE: return (double)active[i];
+        case COL_VISITS: return (double)visits[i];
+        case COL_FAVOURITES: return (double)favourites[i];
+        case COL_LIKES: return (double)likes[i];
+        case COL_DISLIKES: return (double)dislikes[i];
+        case COL_RATING: return rating[i];
+        default: return NAN;
+        }
+    }
+
+    // A row only stores offset + length; the top bit of the length says
+    // whether the offset is into nameHeap or into the mapped source file
+    std::string_view name(size_t i) const {
+        uint32_t len = nameLength[i];
+        const char* base = (len & NAME_IN_HEAP) ? nameHeap.data() : source->data();
+        return std::string_view(base + nameOffset[i], len & ~NAME_IN_HEAP);
+    }
+
+    // Case-folded name, computed once at load so searches never fold rows
+    std::string_view foldedName(size_t i) const {
+        return std::string_view(foldHeap.data() + foldOffset[i], foldLength[i]);
+    }
+
+    // How a game is recognised in another dump: its folded name without
+    // surrounding blanks. Ranks move every day, so they can't be used.
+    std::string_view key(size_t i) const { return trimBlanks(foldedName(i)); }
+
+    // key() for a name that isn't in the table, e.g. one read from a log
+    static std::string keyOf(std::string_view name) { return foldCase(trimBlanks(name)); }
+
+    static std::string_view trimBlanks(std::string_view s) {
+        size_t b = s.find_first_not_of(" \t\r\n");
+        if (b == std::string_view::npos) return {};
+        return s.substr(b, s.find_last_not_of(" \t\r\n") - b + 1);
+    }
+
+    // Keep the file the names point into alive as long as the table
+    void setSource(std::shared_ptr<const MappedFile> file) { source = std::move(file); }
+
+    // Copy every name out of the source file into nameHeap, for a table
+    // that has to outlive the mapping (the file may be rewritten in place)
+    void detachNames() {
+        if (!source) return;
+        std::vector<char> heap;
+        for (size_t i = 0; i < size(); ++i) {
+            std::string_view n = name(i);
+            nameOffset[i] = (uint64_t)heap.size();
+            nameLength[i] = (uint32_t)n.size() | NAME_IN_HEAP;
+            heap.insert(heap.end(), n.begin(), n.end());
+        }
+        nameHeap = std::move(heap);
+        source.reset();
+    }
+
+    // The old menus skipped names that start with '#', keep doing that
+    bool listed(size_t i) const {
+        std::string_view n = name(i);
+        size_t p = n.find_first_not_of(" \t\n\r");
+        return p != std::string_view::npos && n[p] != '#';
+    }
+
+    void addRow(int32_t r, std::string_view n, int64_t act, int64_t vis,
+                int64_t fav, int64_t lk, int64_t dlk, float rat) {
+        rank.push_back(r);
+        if (source && n.data() >= source->data() && n.data() + n.size() <= source->data() + source->size()) {
+            nameOffset.push_back((uint64_t)(n.data() - source->data()));
+            nameLength.push_back((uint32_t)n.size());
+        } else {
+            nameOffset.push_back((uint64_t)nameHeap.size());
+            nameLength.push_back((uint32_t)n.size() | NAME_IN_HEAP);
+            nameHeap.insert(nameHeap.end(), n.begin(), n.end());
+        }
+        foldOffset.push_back((uint64_t)foldHeap.size());
+        foldCaseAppend(n, foldHeap);
+        foldLength.push_back((uint32_t)(foldHeap.size() - foldOffset.back()));
+        active.push_back(act);
+        visits.push_back(vis);
+        favourites.push_back(fav);
+        likes.push_back(lk);
+        dislikes.push_back(dlk);
+        rating.push_back(rat);
+    }
+
+    // Move another table's rows onto the end of this one. Both must share the
+    // same source file; names copied into the other heap are rebased.
+    void append(GameTable&& other) {
+        uint64_t heapBase = (uint64_t)nameHeap.size();
+        nameHeap.insert(nameHeap.end(), other.nameHeap.begin(), other.nameHeap.end());
+        for (size_t i = 0; i < other.size(); ++i) {
+            uint32_t len = other.nameLength[i];
+            nameOffset.push_back((len & NAME_IN_HEAP) ? other.nameOffset[i] + heapBase : other.nameOffset[i]);
+            nameLength.push_back(len);
+        }
+        uint64_t foldBase = (uint64_t)foldHeap.size();
+        foldHeap.insert(foldHeap.end(), other.foldHeap.begin(), other.foldHeap.end());
+        for (uint64_t off : other.foldOffset) foldOffset.push_back(off + foldBase);
+        auto move = [](auto& dst, auto& src) { dst.insert(dst.end(), src.begin(), src.end()); };
+        move(foldLength, other.foldLength);
+        move(rank, other.rank);
+        move(active, other.active);
+        move(visits, other.visits);
+        move(favourites, other.favourites);
+        move(likes, other.likes);
+        move(dislikes, other.dislikes);
+        move(rating, other.rating);
+        issues.merge(other.issues);
+    }
+
+    void reserve(size_t n) {
+        rank.reserve(n); nameOffset.reserve(n); nameLength.reserve(n);
+        foldOffset.reserve(n); foldLength.reserve(n);
+        active.reserve(n); visits.reserve(n); favourites.reserve(n);
+        likes.reserve(n); dislikes.reserve(n); rating.reserve(n);
+    }
+
+    // Snapshot support (see snapshot.h). Names are written once, back to
+    // back; after a load they point straight into the mapped snapshot.
+    template <class Writer>
+    void saveTo(Writer& w) const {
+        w.put("rank", rank);
+        w.put("active", active);
+        w.put("visits", visits);
+        w.put("favourites", favourites);
+        w.put("likes", likes);
+        w.put("dislikes", dislikes);
+        w.put("rating", rating);
+        std::vector<char> names;
+        std::vector<uint32_t> lengths(size());
+        for (size_t i = 0; i < size(); ++i) {
+            std::string_view n = name(i);
+            names.insert(names.end(), n.begin(), n.end());
+            lengths[i] = (uint32_t)n.size();
+        }
+        w.put("names", names);
+        w.put("nameLength", lengths);
+        w.put("foldHeap", foldHeap);
+        w.put("foldOffset", foldOffset);
+        w.put("foldLength", foldLength);
+        std::vector<uint64_t> issueCounts{issues.malformed, issues.overflowed};
+        std::vector<char> issueText;
+        for (const std::string& e : issues.examples) {
+            issueText.insert(issueText.end(), e.begin(), e.end());
+            issueText.push_back('\n');
+        }
+        w.put("issueCounts", issueCounts);
+        w.put("issueText", issueText);
+    }
+
+    template <class Reader>
+    bool loadFrom(const Reader& r) {
+        uint64_t namesAt = 0, namesBytes = 0;
+        if (!r.get("rank", rank) || !r.get("active", active) || !r.get("visits", visits) ||
+            !r.get("favourites", favourites) || !r.get("likes", likes) || !r.get("dislikes", dislikes) ||
+            !r.get("rating", rating) || !r.get("nameLength", nameLength) || !r.find("names", namesAt, namesBytes) ||
+            !r.get("foldHeap", foldHeap) || !r.get("foldOffset", foldOffset) || !r.get("foldLength", foldLength))
+            return false;
+        size_t n = size();
+        if (active.size() != n || visits.size() != n || favourites.size() != n || likes.size() != n ||
+            dislikes.size() != n || rating.size() != n || nameLength.size() != n ||
+            foldOffset.size() != n || foldLength.size() != n)
+            return false;
+        nameOffset.resize(n);
+        uint64_t at = namesAt;
+        for (size_t i = 0; i < n; ++i) {
+            if (nameLength[i] & NAME_IN_HEAP) return false;
+            nameOffset[i] = at;
+            at += nameLength[i];
+            if (foldOffset[i] + foldLength[i] > foldHeap.size()) return false;
+        }
+        if (at - namesAt != namesBytes) return false;
+        std::vector<uint64_t> issueCounts;
+        std::vector<char> issueText;
+        if (!r.get("issueCounts", issueCounts) || issueCounts.size() != 2 || !r.get("issueText", issueText))
+            return false;
+        issues = LoadIssues();
+        issues.malformed = issueCounts[0];
+        issues.overflowed = issueCounts[1];
+        std::string line;
+        for (char c : issueText) {
+            if (c != '\n') { line += c; continue; }
+            issues.examples.push_back(line);
+            line.clear();
+        }
+        nameHeap.clear();
+        source = r.file();
+        return true;
+    }
+
+    // Write row i back out in the same CSV shape as the source file
+    void writeRow(std::ostream& out, size_t i) const {
+        std::string s;
+        appendRow(s, i);
+        out << s;
+    }
+
+    // Same as writeRow but appends to a string, so callers that print many
+    // rows can format into one buffer without going through the stream
+    void appendRow(std::string& out, size_t i) const {
+        out += '#';
+        appendCount(out, rank[i], false);
+        out += ',';
+        appendName(out, name(i));
+        const std::vector<int64_t>* counts[5] = {&active, &visits, &favourites, &likes, &dislikes};
+        for (const auto* col : counts) {
+            out += ",\"";
+            appendCount(out, (*col)[i], true);
+            out += '"';
+        }
+        out += ',';
+        out += formatRating(rating[i]);
+    }
+
+    std::string rowToString(size_t i) const {
+        std::string s;
+        appendRow(s, i);
+        return s;
+    }
+
+    static std::string formatCount(int64_t v) {
+        std::string out;
+        appendCount(out, v, true);
+        return out;
+    }
+
+    static std::string formatRating(float r) {
+        if (std::isnan(r)) return "";
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%g", (double)r);
+        return buf;
+    }
+
+    // A name as a CSV field, quoted only when it has to be
+    static void appendName(std::string& out, std::string_view n) {
+        if (n.find_first_of(",\"\n") == std::string_view::npos) {
+            out.append(n.data(), n.size());
+            return;
+        }
+        out += '"';
+        for (char c : n) {
+            if (c == '"') out += '"';
+            out += c;
+        }
+        out += '"';
+    }
+
+private:
+    static constexpr uint32_t NAME_IN_HEAP = 0x80000000u;
+
+    std::shared_ptr<const MappedFile> source;
+    std::vector<char> nameHeap;
+    std::vector<uint64_t> nameOffset;
+    std::vector<uint32_t> nameLength;
+    std::vector<char> foldHeap;
+    std::vector<uint64_t> foldOffset;
+    std::vector<uint32_t> foldLength;
+
+    // Digits of v, with thousands separators if asked
+    static void appendCount(std::string& out, int64_t v, bool separators) {
+        char digits[24];
+        uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+        int n = 0;
+        do { digits[n++] = (char)('0' + u % 10); u /= 10; } while (u);
+        if (v < 0) out += '-';
+        for (int k = n - 1; k >= 0; --k) {
+            out += digits[k];
+            if (separators && k > 0 && k % 3 == 0) out += ',';
+        }
+    }
+};
+
+// Parse the records in buf[begin, end) into `table`. `begin` must be the
+// start of a record.
+inline void parseGameRows(std::string_view buf, size_t begin, size_t end, GameTable& table) {
+    CsvScanner scanner(buf.substr(0, end), begin);
+    std::vector<CsvField> f;
+    std::string unescaped;
+    while (scanner.nextRecord(f)) {
+        if (f.size() < 2) continue;
+        f.resize(GAME_COLUMN_COUNT);
+
+        int64_t counts[GAME_COLUMN_COUNT] = {0};
+        float rat = NAN;
+        std::string_view rankStr = f[COL_RANK].text;
+        if (!rankStr.empty() && rankStr[0] == '#') rankStr.remove_prefix(1);
+        for (int c = COL_RANK; c < COL_RATING; ++c) {
+            if (c == COL_NAME) continue;
+            std::string_view cell = c == COL_RANK ? rankStr : f[c].text;
+            CountStatus st = readCount(cell, counts[c]);
+            if (st == COUNT_OK || st == COUNT_EMPTY) continue;
+            if (st == COUNT_OVERFLOW) ++table.issues.overflowed;
+            else ++table.issues.malformed;
+            table.issues.note(rankStr, COLUMN_NAMES[c], cell, countStatusName(st));
+        }
+        std::string_view ratingStr = f[COL_RATING].text;
+        if (!parseRating(ratingStr, rat) && ratingStr.find_first_not_of(" \r") != std::string_view::npos) {
+            ++table.issues.malformed;
+            table.issues.note(rankStr, "rating", ratingStr, "malformed");
+        }
+
+        std::string_view name = f[COL_NAME].text;
+        if (f[COL_NAME].escaped) {
+            unescaped = unescapeCSV(name);
+            name = unescaped;
+        }
+        table.addRow((int32_t)counts[COL_RANK], name, counts[COL_ACTIVE], counts[COL_VISITS],
+                     counts[COL_FAVOURITES], counts[COL_LIKES], counts[COL_DISLIKES], rat);
+    }
+}
+
+// Split buf[begin, size) into up to `parts` ranges that each start and end
+// on a record boundary, even if a nominal cut lands inside a quoted field.
+inline std::vector<size_t> splitCSVChunks(std::string_view buf, size_t begin, size_t parts) {
+    size_t total = buf.size() - begin;
+    size_t step = total / parts;
+
+    // Quote parity of each nominal slice tells us the quote state at each cut
+    std::vector<size_t> quotes(parts, 0);
+    std::vector<std::thread> workers;
+    for (size_t k = 0; k + 1 < parts; ++k)
+        workers.emplace_back([&, k] { quotes[k] = countQuotes(buf.data() + begin + k * step, step); });
+    for (auto& t : workers) t.join();
+
+    std::vector<size_t> cuts{begin};
+    size_t seen = 0;
+    for (size_t k = 1; k < parts; ++k) {
+        seen += quotes[k - 1];
+        size_t cut = nextCSVRecordStart(buf, begin + k * step, seen % 2 == 1);
+        if (cut > cuts.back() && cut < buf.size()) cuts.push_back(cut);
+    }
+    cuts.push_back(buf.size());
+    return cuts;
+}
+
+// Load roblox_games.csv into a GameTable. Header line is returned separately.
+// The file is mapped and scanned in place. Large files are split into
+// record-aligned chunks, parsed on all cores into per-thread tables and
+// stitched back together in file order. The table keeps `file` alive for
+// names that point into it.
+inline bool loadGameTable(std::shared_ptr<const MappedFile> file, GameTable& table, std::string& header,
+                          unsigned threads = 0) {
+    std::string_view buf = file->view();
+
+    size_t pos = skipCSVRecord(buf, 0);
+    header = trim(std::string(buf.substr(0, pos)));
+    if (header.empty()) return false;
+
+    // Below a few MB thread start-up costs more than it saves
+    const size_t MIN_CHUNK = 4 * 1024 * 1024;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t parts = std::min<size_t>(threads, (buf.size() - pos) / MIN_CHUNK + 1);
+
+    std::vector<size_t> cuts = splitCSVChunks(buf, pos, parts);
+    std::vector<GameTable> partial(cuts.size() - 1);
+    std::vector<std::thread> workers;
+    for (size_t k = 0; k + 1 < cuts.size(); ++k) {
+        auto work = [&, k] {
+            GameTable& t = partial[k];
+            t.setSource(file);
+            // Rough row estimate from the size of the first line in the chunk
+            size_t next = skipCSVRecord(buf, cuts[k]);
+            if (next > cuts[k]) t.reserve((cuts[k + 1] - cuts[k]) / (next - cuts[k]) + 1);
+            parseGameRows(buf, cuts[k], cuts[k + 1], t);
+        };
+        if (cuts.size() == 2) work();
+        else workers.emplace_back(work);
+    }
+    for (auto& t : workers) t.join();
+    file->endSequentialScan();
+
+    size_t rows = 0;
+    for (const GameTable& t : partial) rows += t.size();
+    table = std::move(partial[0]);
+    table.reserve(rows);
+    for (size_t k = 1; k < partial.size(); ++k) table.append(std::move(partial[k]));
+    return true;
+}
+
+inline bool loadGameTable(const std::string& path, GameTable& table, std::string& header,
+                          unsigned threads = 0) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path)) return false;
+    return loadGameTable(std::move(file), table, header, threads);
+}
+
+#endif
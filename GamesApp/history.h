@@ -0,0 +1,475 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "case_fold.h"
+#include "game_table.h"
+#include "mapped_file.h"
+#include "metrics.h"
+#include "utils.h"
+
+// Daily roblox_games.csv dumps kept side by side in one file
+// (roblox_history.bin), so a game's numbers can be followed over time.
+//
+// Games are matched across days by case-folded, trimmed name, since ranks
+// change every day. Each game has its own run of bytes: one record per day
+// it appeared in, holding the days since its previous record and how much
+// rank, each count and the rating (in hundredths, -1 if blank) changed, all
+// as zigzag LEB128 varints. Day to day most of those changes are small,
+// so a record is typically 10-20 bytes against ~90 in the CSV.
+//
+// The directory, sorted by name, keeps each game's values as of its last
+// record. Walking back from those needs only its newest records: the last
+// byte of a varint is the one without the high bit, so records can be
+// read from the end. "The last 90 days of X" therefore reads 90 records of
+// one game, and "risers this week" about a week's worth from every game.
+//
+// Ingesting a day writes a new file: each game's old bytes are copied as
+// they are and the new record appended, then the file is renamed into
+// place. Days must be ingested in order.
+
+const uint32_t HISTORY_VERSION = 1;
+const int HISTORY_FIELDS = 7;
+
+// Which GameColumn each stored field is
+const GameColumn HISTORY_COLUMNS[HISTORY_FIELDS] = {
+    COL_RANK, COL_ACTIVE, COL_VISITS, COL_FAVOURITES, COL_LIKES, COL_DISLIKES, COL_RATING};
+
+struct HistoryHeader {
+    char magic[8];        // "GHISTORY"
+    uint32_t version;
+    uint32_t byteOrder;   // 0x01020304 as written by the saving machine
+    uint32_t dayCount;
+    uint32_t reserved;
+    uint64_t gameCount;
+    uint64_t heapBytes;   // names
+    uint64_t blobBytes;   // records
+    uint64_t csvBytes;    // size of every CSV ingested so far, for comparison
+};
+
+struct HistoryGame {
+    uint64_t keyOffset;   // folded name in the heap, the sort key
+    uint64_t nameOffset;  // name as it appeared most recently
+    uint32_t keyLength;
+    uint32_t nameLength;
+    uint64_t blobOffset;
+    uint64_t blobLength;
+    uint32_t records;
+    int32_t lastDay;
+    int64_t last[HISTORY_FIELDS];   // values on lastDay
+};
+
+struct HistoryPoint {
+    int32_t day;
+    int64_t values[HISTORY_FIELDS];
+};
+
+struct HistoryRiser {
+    const HistoryGame* game;
+    int32_t fromDay;   // the record compared against
+    int64_t before;
+    int64_t after;
+};
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+inline int32_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+inline std::string formatDay(int32_t days) {
+    int32_t z = days + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    int y = (int)yoe + era * 400 + (m <= 2);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u", y, m, d);
+    return buf;
+}
+
+// "YYYY-MM-DD" anywhere in `s` (so dated file names work too)
+inline bool findDay(std::string_view s, int32_t& day) {
+    auto digits = [&](size_t at, size_t n) {
+        for (size_t k = at; k < at + n; ++k)
+            if (s[k] < '0' || s[k] > '9') return false;
+        return true;
+    };
+    for (size_t i = 0; i + 10 <= s.size(); ++i) {
+        if (!digits(i, 4) || s[i + 4] != '-' || !digits(i + 5, 2) || s[i + 7] != '-' || !digits(i + 8, 2)) continue;
+        int y = std::atoi(std::string(s.substr(i, 4)).c_str());
+        unsigned m = (unsigned)std::atoi(std::string(s.substr(i + 5, 2)).c_str());
+        unsigned d = (unsigned)std::atoi(std::string(s.substr(i + 8, 2)).c_str());
+        if (m < 1 || m > 12 || d < 1 || d > 31) continue;
+        day = daysFromCivil(y, m, d);
+        if (formatDay(day) != s.substr(i, 10)) continue;   // e.g. 2024-02-30
+        return true;
+    }
+    return false;
+}
+
+inline int32_t today() {
+    return (int32_t)(std::time(nullptr) / 86400);
+}
+
+namespace history_detail {
+
+inline void putVarint(std::vector<char>& out, int64_t v) {
+    uint64_t z = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);   // zigzag: small either side of 0
+    while (z >= 0x80) {
+        out.push_back((char)(z | 0x80));
+        z >>= 7;
+    }
+    out.push_back((char)z);
+}
+
+inline int64_t unzigzag(uint64_t z) {
+    return (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+}
+
+// Varint starting at p; p moves past it. False if it runs past end.
+inline bool getVarint(const unsigned char*& p, const unsigned char* end, int64_t& v) {
+    uint64_t z = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char b = *p++;
+        z |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            v = unzigzag(z);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Varint ending just before `end`; end moves to its first byte
+inline bool getVarintBackward(const unsigned char* begin, const unsigned char*& end, int64_t& v) {
+    if (end <= begin || (end[-1] & 0x80)) return false;
+    const unsigned char* p = end - 1;
+    while (p > begin && (p[-1] & 0x80)) --p;
+    const unsigned char* q = p;
+    if (!getVarint(q, end, v)) return false;
+    end = p;
+    return true;
+}
+
+// Step one record back from `day`/`values`. False at the first record.
+inline bool popRecord(const unsigned char* begin, const unsigned char*& end, int32_t& day,
+                      int64_t values[HISTORY_FIELDS]) {
+    if (end <= begin) return false;
+    int64_t delta[HISTORY_FIELDS], gap;
+    for (int f = HISTORY_FIELDS - 1; f >= 0; --f)
+        if (!getVarintBackward(begin, end, delta[f])) return false;
+    if (!getVarintBackward(begin, end, gap)) return false;
+    for (int f = 0; f < HISTORY_FIELDS; ++f) values[f] -= delta[f];
+    day -= (int32_t)gap;
+    return true;
+}
+
+inline int64_t storedRating(float r) {
+    return std::isnan(r) ? -1 : (int64_t)std::lround((double)r * 100);
+}
+
+inline size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+} // namespace history_detail
+
+class HistoryStore {
+public:
+    // Map the store. False if it's missing or not a history file this
+    // build can read.
+    bool open(const std::string& path) {
+        auto f = std::make_shared<MappedFile>();
+        if (!f->open(path) || f->size() < sizeof(HistoryHeader)) return false;
+        HistoryHeader h;
+        std::memcpy(&h, f->data(), sizeof(h));
+        if (std::memcmp(h.magic, "GHISTORY", 8) != 0 || h.version != HISTORY_VERSION || h.byteOrder != 0x01020304u)
+            return false;
+        size_t daysAt = sizeof(h);
+        size_t gamesAt = daysAt + history_detail::align8((size_t)h.dayCount * sizeof(int32_t));
+        if (h.gameCount > (f->size() - std::min(gamesAt, f->size())) / sizeof(HistoryGame)) return false;
+        size_t heapAt = gamesAt + (size_t)h.gameCount * sizeof(HistoryGame);
+        if (heapAt > f->size() || h.heapBytes > f->size() - heapAt) return false;
+        size_t blobAt = heapAt + (size_t)h.heapBytes;
+        if (h.blobBytes != f->size() - blobAt) return false;
+
+        days_.resize(h.dayCount);
+        std::memcpy(days_.data(), f->data() + daysAt, days_.size() * sizeof(int32_t));
+        directory = reinterpret_cast<const HistoryGame*>(f->data() + gamesAt);
+        gameCount = (size_t)h.gameCount;
+        heap = std::string_view(f->data() + heapAt, (size_t)h.heapBytes);
+        blobs = reinterpret_cast<const unsigned char*>(f->data() + blobAt);
+        blobBytes = h.blobBytes;
+        csvBytes_ = h.csvBytes;
+        for (size_t i = 0; i < gameCount; ++i) {
+            const HistoryGame& g = directory[i];
+            if (g.keyOffset + g.keyLength > heap.size() || g.nameOffset + g.nameLength > heap.size() ||
+                g.blobOffset > blobBytes || g.blobLength > blobBytes - g.blobOffset) {
+                directory = nullptr;
+                gameCount = 0;
+                return false;
+            }
+        }
+        file = std::move(f);
+        return true;
+    }
+
+    size_t games() const { return gameCount; }
+    const std::vector<int32_t>& days() const { return days_; }
+    int32_t latestDay() const { return days_.empty() ? 0 : days_.back(); }
+    uint64_t bytes() const { return file ? file->size() : 0; }
+    uint64_t csvBytes() const { return csvBytes_; }
+
+    std::string_view name(const HistoryGame& g) const { return heap.substr((size_t)g.nameOffset, g.nameLength); }
+
+    // Exact (case-insensitive) name lookup, nullptr if never seen
+    const HistoryGame* find(std::string_view gameName) const {
+        std::string key = foldCase(trim(std::string(gameName)));
+        const HistoryGame* end = directory + gameCount;
+        const HistoryGame* it = std::lower_bound(directory, end, key, [&](const HistoryGame& g, const std::string& k) {
+            return keyOf(g) < k;
+        });
+        return it != end && keyOf(*it) == key ? it : nullptr;
+    }
+
+    // Up to `limit` names containing `text`, for "did you mean"
+    std::vector<std::string_view> similar(std::string_view text, size_t limit) const {
+        std::string key = foldCase(trim(std::string(text)));
+        std::vector<std::string_view> out;
+        for (size_t i = 0; i < gameCount && out.size() < limit && !key.empty(); ++i)
+            if (keyOf(directory[i]).find(key) != std::string_view::npos) out.push_back(name(directory[i]));
+        return out;
+    }
+
+    // g's records from fromDay on, oldest first
+    std::vector<HistoryPoint> series(const HistoryGame& g, int32_t fromDay) const {
+        std::vector<HistoryPoint> out;
+        HistoryPoint p;
+        p.day = g.lastDay;
+        std::memcpy(p.values, g.last, sizeof(p.values));
+        const unsigned char* begin = blobs + g.blobOffset;
+        const unsigned char* end = begin + g.blobLength;
+        size_t walked = 0;
+        while (g.records > 0 && p.day >= fromDay) {
+            out.push_back(p);
+            ++walked;
+            if (!history_detail::popRecord(begin, end, p.day, p.values) || end == begin) break;
+        }
+        metrics::addRows(walked);
+        std::reverse(out.begin(), out.end());
+        return out;
+    }
+
+    // The n games whose active players grew most between the latest day
+    // and `window` days before it, biggest gain first. Each is compared
+    // with its last record on or before that day, or its first record if
+    // it is newer. Games missing from the latest day are left out.
+    std::vector<HistoryRiser> risers(int32_t window, size_t n, GameColumn column = COL_ACTIVE) const {
+        int field = fieldOf(column);
+        std::vector<HistoryRiser> out;
+        if (days_.empty() || field < 0 || n == 0) return out;
+        int32_t latest = latestDay(), target = latest - window;
+        auto better = [](const HistoryRiser& a, const HistoryRiser& b) {
+            int64_t ga = a.after - a.before, gb = b.after - b.before;
+            return ga != gb ? ga > gb : a.game < b.game;
+        };
+        std::priority_queue<HistoryRiser, std::vector<HistoryRiser>, decltype(better)> heap(better);
+        size_t walked = 0;
+        for (size_t i = 0; i < gameCount; ++i) {
+            const HistoryGame& g = directory[i];
+            if (g.lastDay != latest || g.records == 0) continue;
+            int32_t day = g.lastDay;
+            int64_t values[HISTORY_FIELDS];
+            std::memcpy(values, g.last, sizeof(values));
+            const unsigned char* begin = blobs + g.blobOffset;
+            const unsigned char* end = begin + g.blobLength;
+            while (day > target) {
+                int32_t d = day;
+                int64_t v[HISTORY_FIELDS];
+                std::memcpy(v, values, sizeof(v));
+                const unsigned char* e = end;
+                ++walked;
+                // Stepping back from the first record leads to nothing
+                if (!history_detail::popRecord(begin, e, d, v) || e == begin) break;
+                day = d;
+                std::memcpy(values, v, sizeof(v));
+                end = e;
+            }
+            if (day == latest) continue;   // nothing earlier to compare with
+            HistoryRiser r{&g, day, values[field], g.last[field]};
+            if (heap.size() < n) heap.push(r);
+            else if (better(r, heap.top())) { heap.pop(); heap.push(r); }
+        }
+        metrics::addRows(walked);
+        out.resize(heap.size());
+        for (size_t i = out.size(); i-- > 0; heap.pop()) out[i] = heap.top();
+        return out;
+    }
+
+    static int fieldOf(GameColumn c) {
+        for (int f = 0; f < HISTORY_FIELDS; ++f)
+            if (HISTORY_COLUMNS[f] == c) return f;
+        return -1;
+    }
+
+    // Append `table` as day `day` to the store at `path`, creating it if
+    // needed. `csvBytes` is the dump's size, kept to report the savings.
+    static bool ingest(const std::string& path, const GameTable& table, uint64_t csvBytes, int32_t day,
+                       std::string& error) {
+        using namespace history_detail;
+        HistoryStore old;
+        bool exists = old.open(path);
+        if (!exists && std::ifstream(path).good()) {
+            error = path + " isn't a history file this version can read";
+            return false;
+        }
+        if (exists && day <= old.latestDay()) {
+            error = "history already runs to " + formatDay(old.latestDay()) + "; days must be added in order";
+            return false;
+        }
+
+        // One row per game: the first (best ranked) when a name repeats
+        std::vector<std::pair<std::string, uint32_t>> incoming;
+        incoming.reserve(table.size());
+        for (size_t i = 0; i < table.size(); ++i) {
+            std::string key = foldCase(trim(std::string(table.name(i))));
+            if (!key.empty()) incoming.push_back({std::move(key), (uint32_t)i});
+        }
+        std::stable_sort(incoming.begin(), incoming.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        incoming.erase(std::unique(incoming.begin(), incoming.end(),
+                                   [](const auto& a, const auto& b) { return a.first == b.first; }),
+                       incoming.end());
+
+        // Merge the old directory with today's names. New records are
+        // encoded up front so every blob's final size is known before writing.
+        std::vector<HistoryGame> games;
+        std::vector<const HistoryGame*> from;   // old entry per game, or nullptr
+        std::vector<uint64_t> recordAt, recordLength;   // into records; length 0 when absent today
+        std::vector<char> records, names;
+        games.reserve(old.gameCount + incoming.size());
+        size_t a = 0, b = 0;
+        while (a < old.gameCount || b < incoming.size()) {
+            int cmp = a == old.gameCount ? 1 : b == incoming.size() ? -1
+                    : old.keyOf(old.directory[a]).compare(incoming[b].first);
+            HistoryGame g{};
+            const HistoryGame* prev = cmp <= 0 ? &old.directory[a++] : nullptr;
+            if (prev) g = *prev;
+            std::string_view key = prev ? old.keyOf(*prev) : std::string_view(incoming[b].first);
+            std::string_view shown = prev ? old.name(*prev) : std::string_view();
+            uint64_t at = records.size();
+            if (cmp >= 0) {
+                size_t row = incoming[b++].second;
+                shown = trimmed(table.name(row));
+                int64_t values[HISTORY_FIELDS] = {table.rank[row], table.active[row], table.visits[row],
+                                                  table.favourites[row], table.likes[row], table.dislikes[row],
+                                                  storedRating(table.rating[row])};
+                putVarint(records, day - g.lastDay);
+                for (int f = 0; f < HISTORY_FIELDS; ++f) putVarint(records, values[f] - g.last[f]);
+                std::memcpy(g.last, values, sizeof(values));
+                g.lastDay = day;
+                ++g.records;
+            }
+            g.keyOffset = names.size();
+            g.keyLength = (uint32_t)key.size();
+            names.insert(names.end(), key.begin(), key.end());
+            g.nameOffset = names.size();
+            g.nameLength = (uint32_t)shown.size();
+            names.insert(names.end(), shown.begin(), shown.end());
+            games.push_back(g);
+            from.push_back(prev);
+            recordAt.push_back(at);
+            recordLength.push_back(records.size() - at);
+        }
+        uint64_t blobAt = 0;
+        for (size_t i = 0; i < games.size(); ++i) {
+            games[i].blobOffset = blobAt;
+            games[i].blobLength = (from[i] ? from[i]->blobLength : 0) + recordLength[i];
+            blobAt += games[i].blobLength;
+        }
+
+        HistoryHeader h{};
+        std::memcpy(h.magic, "GHISTORY", 8);
+        h.version = HISTORY_VERSION;
+        h.byteOrder = 0x01020304u;
+        std::vector<int32_t> days = old.days_;
+        days.push_back(day);
+        h.dayCount = (uint32_t)days.size();
+        h.gameCount = games.size();
+        h.heapBytes = names.size();
+        h.blobBytes = blobAt;
+        h.csvBytes = old.csvBytes_ + csvBytes;
+
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                error = "can't write " + tmp;
+                return false;
+            }
+            static const char zeros[8] = {};
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            out.write(reinterpret_cast<const char*>(days.data()), (std::streamsize)(days.size() * sizeof(int32_t)));
+            out.write(zeros, (std::streamsize)(align8(days.size() * sizeof(int32_t)) - days.size() * sizeof(int32_t)));
+            out.write(reinterpret_cast<const char*>(games.data()), (std::streamsize)(games.size() * sizeof(HistoryGame)));
+            out.write(names.data(), (std::streamsize)names.size());
+            for (size_t i = 0; i < games.size(); ++i) {
+                if (from[i])
+                    out.write(reinterpret_cast<const char*>(old.blobs + from[i]->blobOffset),
+                              (std::streamsize)from[i]->blobLength);
+                if (recordLength[i]) out.write(records.data() + recordAt[i], (std::streamsize)recordLength[i]);
+            }
+            if (!out) {
+                out.close();
+                std::remove(tmp.c_str());
+                error = "can't write " + tmp;
+                return false;
+            }
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            error = "can't replace " + path;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    std::vector<int32_t> days_;
+    const HistoryGame* directory = nullptr;
+    size_t gameCount = 0;
+    std::string_view heap;
+    const unsigned char* blobs = nullptr;
+    uint64_t blobBytes = 0;
+    uint64_t csvBytes_ = 0;
+
+    std::string_view keyOf(const HistoryGame& g) const { return heap.substr((size_t)g.keyOffset, g.keyLength); }
+
+    static std::string_view trimmed(std::string_view s) {
+        size_t b = s.find_first_not_of(" \t\r\n");
+        if (b == std::string_view::npos) return {};
+        size_t e = s.find_last_not_of(" \t\r\n");
+        return s.substr(b, e - b + 1);
+    }
+};
+
+#endif
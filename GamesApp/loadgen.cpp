@@ -0,0 +1,95 @@
+// Load generator for `main --serve`.
+// Build: g++ -std=c++17 -O2 -pthread loadgen.cpp -o loadgen
+// Usage: ./loadgen [socket] [clients] [requests per client] [script]
+//
+// Each client is a thread with its own connection sending requests back
+// to back. Requests cycle through the script's lines (batch-mode syntax)
+// or a built-in mix of searches and filters. Prints QPS and latency
+// percentiles over all requests.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "protocol.h"
+
+using namespace std;
+
+#ifdef GAMES_HAVE_SOCKETS
+
+static vector<string> defaultMix() {
+    return {
+        "search obby",       "search simulator", "search tycoon",  "fuzzy 1 brokhaven",
+        "search adopt",      "rating>=90",       "rating=80-85",   "top visits 10",
+        "top favourites 20", "fuzzy 2 blox frut", "search tower",  "top rating 10",
+    };
+}
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "games.sock";
+    size_t clients = argc > 2 ? stoul(argv[2]) : 8;
+    size_t perClient = argc > 3 ? stoul(argv[3]) : 1000;
+    vector<string> script = defaultMix();
+    if (argc > 4) {
+        ifstream in(argv[4]);
+        string line;
+        script.clear();
+        while (getline(in, line))
+            if (!line.empty() && line[0] != '#') script.push_back(line);
+        if (script.empty()) {
+            cerr << "No commands in " << argv[4] << "\n";
+            return 1;
+        }
+    }
+
+    vector<vector<double>> latencies(clients);
+    atomic<size_t> errors{0}, failed{0}, bytes{0};
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            GamesClient client;
+            if (!client.connect(path)) { ++failed; return; }
+            latencies[c].reserve(perClient);
+            bool ok;
+            string body;
+            for (size_t r = 0; r < perClient; ++r) {
+                const string& cmd = script[(c * 7 + r) % script.size()];
+                auto t0 = chrono::steady_clock::now();
+                if (!client.request(cmd, ok, body)) { ++failed; return; }
+                latencies[c].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+                if (!ok) ++errors;
+                bytes += body.size();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<double> all;
+    for (auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    sort(all.begin(), all.end());
+    auto pct = [&](double q) { return all.empty() ? 0.0 : all[(size_t)(q * (double)(all.size() - 1))]; };
+
+    printf("clients %zu, requests %zu, errors %zu, broken connections %zu\n",
+           clients, all.size(), errors.load(), failed.load());
+    printf("%.0f requests/s, %.1f MB/s of replies over %.2f s\n",
+           (double)all.size() / secs, (double)bytes / secs / (1024 * 1024), secs);
+    printf("latency us: p50 %.0f, p90 %.0f, p99 %.0f, p99.9 %.0f, max %.0f\n",
+           pct(0.50), pct(0.90), pct(0.99), pct(0.999), all.empty() ? 0.0 : all.back());
+    return failed ? 1 : 0;
+}
+
+#else
+
+int main() {
+    cerr << "loadgen needs Unix domain sockets\n";
+    return 1;
+}
+
+#endif
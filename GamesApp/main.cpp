@@ -4,154 +4,414 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <charconv>
 #include <iomanip> // for std::quoted
 #include <set>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
 // removed picojson
+#include "utils.h"
+#include "auth.h"
+#include "game_table.h"
+#include "name_index.h"
+#include "rating_index.h"
+#include "stats.h"
+#include "recommend.h"
+#include "cooccur.h"
+#include "favorites.h"
+#include "snapshot.h"
+#include "dataset.h"
+#include "bm25.h"
+#include "history.h"
+#include "batch.h"
+#include "result_writer.h"
+#include "server.h"
+#include "metrics.h"
 
 using namespace std;
 
-// Simple CSV line parser (handles quoted commas)
-vector<string> splitCSVLine(const string &line) {
-    vector<string> cols;
-    string cur;
-    bool inQuotes = false;
-    for (size_t i = 0; i < line.size(); ++i) {
-        char c = line[i];
-        if (c == '"') {
-            inQuotes = !inQuotes;
-            continue;
+// Every allocation goes through here so --metrics can count them per
+// operation. With metrics off it's malloc plus one branch. Kept out of
+// line so the compiler pairs callers with new/delete, not malloc/free.
+__attribute__((noinline)) void* operator new(size_t n) {
+    metrics::noteAllocation();
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Name search shared by options 1 and 4. "text~N" asks for names within
+// N typos of text. Otherwise the words of the query are ranked with BM25
+// plus popularity and only the best SHOWN_MATCHES come back, with `total`
+// set to how many names matched; `total` equals the rows returned for the
+// other paths. Names that only contain the query inside a word (say
+// "coon" in "Raccoon") follow the ranked ones in file order, also at most
+// SHOWN_MATCHES of them, and a query that matches nothing at all falls
+// back to typo-tolerant matching. Says so when it went fuzzy.
+static const size_t SHOWN_MATCHES = 20;
+
+static vector<size_t> searchNames(const NameIndex& index, const RelevanceIndex& relevance,
+                                  const string& query, size_t& total) {
+    size_t tilde = query.rfind('~');
+    vector<size_t> rows;
+    if (tilde != string::npos && tilde + 1 < query.size() &&
+        query.find_first_not_of("0123456789", tilde + 1) == string::npos) {
+        string text = trim(query.substr(0, tilde));
+        // Huge suffixes are out of range for from_chars; they mean "as many as allowed"
+        unsigned long n = 9;
+        from_chars(query.data() + tilde + 1, query.data() + query.size(), n);
+        int maxDistance = (int)min(9ul, n);
+        for (const auto& m : index.fuzzySearch(text, maxDistance)) rows.push_back(m.row);
+        total = rows.size();
+        return rows;
+    }
+    // Ranked word matches first, then names that only contain the query
+    // inside a word ("haven" in "Brookhaven"), in file order. Up to
+    // SHOWN_MATCHES of each are returned; `total` counts them all
+    vector<uint32_t> ranked;
+    for (const auto& m : relevance.search(query, SHOWN_MATCHES, &total, &ranked)) rows.push_back(m.row);
+    sort(ranked.begin(), ranked.end());
+    size_t inside = 0;
+    for (size_t row : index.search(query)) {
+        if (binary_search(ranked.begin(), ranked.end(), (uint32_t)row)) continue;
+        if (inside++ < SHOWN_MATCHES) rows.push_back(row);
+        ++total;
+    }
+    if (!rows.empty()) return rows;
+    if (!query.empty()) {
+        int maxDistance = NameIndex::defaultMaxDistance(query);
+        for (const auto& m : index.fuzzySearch(query, maxDistance)) rows.push_back(m.row);
+        if (!rows.empty()) {
+            cout << "\nNo exact matches, showing names within " << maxDistance
+                 << (maxDistance == 1 ? " typo" : " typos") << ", closest first.\n";
         }
-        if (c == ',' && !inQuotes) {
-            cols.push_back(cur);
-            cur.clear();
-        } else cur.push_back(c);
     }
-    cols.push_back(cur);
-    return cols;
+    total = rows.size();
+    return rows;
 }
 
-string toLower(const string& s) {
-    string result = s;
-    transform(result.begin(), result.end(), result.begin(), ::tolower);
-    return result;
+// "N matches found:", or which slice of them is shown when ranked
+static void printMatchCount(size_t shown, size_t total) {
+    if (total > shown) cout << "Best " << shown << " of " << total << " matches:\n";
+    else cout << total << " matches found:\n";
 }
 
-string trim(const string& s) {
-    size_t start = s.find_first_not_of(" \t\n\r");
-    if (start == string::npos) return "";
-    size_t end = s.find_last_not_of(" \t\n\r");
-    return s.substr(start, end - start + 1);
+// Batch mode: `main --batch [script]` runs the script's queries (stdin
+// if no file is given) and exits. Results on stdout, timings on stderr.
+static int runBatch(const char* scriptPath) {
+    GameTable table;
+    string header;
+    NameIndex nameIndex;
+    RatingIndex ratingIndex;
+    bool loaded;
+    {
+        ScopedOp timed(OP_LOAD);
+        loaded = loadGamesCached("roblox_games.csv", table, header, nameIndex, ratingIndex);
+    }
+    if (!loaded) {
+        cerr << "Oops, I can't find any data\n";
+        return 1;
+    }
+    TopIndex tops;
+    RelevanceIndex relevance;
+    relevance.build(table);
+    BatchRunner runner(table, nameIndex, ratingIndex, tops, relevance);
+
+    ifstream script;
+    if (scriptPath) {
+        script.open(scriptPath);
+        if (!script) {
+            cerr << "Can't open " << scriptPath << "\n";
+            return 1;
+        }
+    }
+    return runner.run(scriptPath ? script : cin, cout, cerr) == 0 ? 0 : 2;
 }
 
-int main() {
-    // User login/signup
-    string currentUser;
-    string favoritesFile;
-    while (true) {
-        cout << "Welcome! Type 1 to Login, 2 to Sign Up, or 0 to Exit: ";
-        string option; getline(cin, option);
-        option = trim(option);
-        if (option == "0") return 0;
-        if (option == "2") { // Sign up
-            cout << "Sign up - enter your username: ";
-            string name; getline(cin, name);
-            name = trim(name);
-            cout << "Enter your password: ";
-            string password; getline(cin, password);
-            password = trim(password);
+// Daily dumps accumulate here (see history.h)
+static const char* const HISTORY_PATH = "roblox_history.bin";
 
-            ifstream userCheck("users.csv");
-            bool exists = false;
-            string uline;
-            while (getline(userCheck, uline)) {
-                vector<string> fields = splitCSVLine(uline);
-                if (fields.size() >= 2 && fields[0] == name) { exists = true; break; }
-            }
-            if (exists) {
-                cout << "That username is already taken. Try again.\n";
-                continue;
-            }
-            ofstream newUser("users.csv", ios::app);
-            newUser << name << "," << password << "\n";
-            cout << "Sign up successful! Please log in.\n";
-        } else if (option == "1") {
-            cout << "Login - enter your username: ";
-            string name; getline(cin, name);
-            name = trim(name);
-            cout << "Enter your password: ";
-            string password; getline(cin, password);
-            password = trim(password);
+// `main --ingest <dump.csv> [YYYY-MM-DD]` adds a day's dump to the
+// history. The date defaults to one in the file name, then to today (UTC).
+static int runIngest(const string& csvPath, const string& date) {
+    int32_t day;
+    if (!date.empty()) {
+        if (!findDay(date, day) || date.size() != 10) {
+            cerr << "Expected a date like 2024-10-31, got " << date << "\n";
+            return 1;
+        }
+    } else if (!findDay(csvPath, day)) {
+        day = today();
+    }
+    GameTable table;
+    string header;
+    if (!loadGameTable(csvPath, table, header)) {
+        cerr << "Can't read " << csvPath << "\n";
+        return 1;
+    }
+    if (!table.issues.empty()) cerr << "Warning: " << table.issues.summary() << "\n";
+    error_code ec;
+    uint64_t csvBytes = filesystem::file_size(csvPath, ec);
+    string error;
+    bool ok;
+    {
+        ScopedOp timed(OP_HISTORY);
+        ok = HistoryStore::ingest(HISTORY_PATH, table, ec ? 0 : csvBytes, day, error);
+    }
+    if (!ok) {
+        cerr << "Can't add " << csvPath << ": " << error << "\n";
+        return 1;
+    }
+    HistoryStore store;
+    if (!store.open(HISTORY_PATH)) {
+        cerr << "Can't read back " << HISTORY_PATH << "\n";
+        return 1;
+    }
+    cout << "Added " << formatDay(day) << " (" << table.size() << " rows). " << HISTORY_PATH << " now has "
+         << store.days().size() << " days of " << store.games() << " games in " << store.bytes() / 1024
+         << " KB, " << fixed << setprecision(1) << 100.0 * (double)store.bytes() / (double)max<uint64_t>(1, store.csvBytes())
+         << "% of the " << store.csvBytes() / 1024 << " KB of CSV it came from.\n";
+    return 0;
+}
 
-            ifstream userFile("users.csv");
-            bool found = false;
-            string uline;
-            while (getline(userFile, uline)) {
-                vector<string> fields = splitCSVLine(uline);
-                if (fields.size() >= 2 && fields[0] == name && fields[1] == password) {
-                    found = true; break;
-                }
-            }
-            if (found) {
-                cout << "Welcome, " << name << "!\n";
-                currentUser = name;
-                favoritesFile = "favorites_" + name + ".csv";
-                break;
-            } else {
-                cout << "Incorrect username or password. Try again.\n";
-            }
-        } else {
-            cout << "Invalid option, try again.\n";
+// `main --history <name> [days]`: that game's numbers for the last `days`
+// days of the history (90 by default), oldest first, as CSV
+static int runHistory(const string& gameName, int days) {
+    HistoryStore store;
+    if (!store.open(HISTORY_PATH)) {
+        cerr << "No history yet; add dumps with --ingest <csv> [YYYY-MM-DD]\n";
+        return 1;
+    }
+    const HistoryGame* game = store.find(gameName);
+    if (!game) {
+        cerr << "No history for \"" << gameName << "\"";
+        vector<string_view> close = store.similar(gameName, 5);
+        if (!close.empty()) {
+            cerr << ". Did you mean:";
+            for (string_view n : close) cerr << "\n  " << n;
         }
+        cerr << "\n";
+        return 1;
+    }
+    vector<HistoryPoint> points;
+    {
+        ScopedOp timed(OP_HISTORY);
+        points = store.series(*game, store.latestDay() - (days - 1));
     }
+    string out = "Date,Rank,Active,Visits,Favourites,Likes,Dislikes,Rating\n";
+    for (const HistoryPoint& p : points) {
+        out += formatDay(p.day);
+        out += ",#" + to_string(p.values[0]);
+        for (int f = 1; f < HISTORY_FIELDS - 1; ++f) out += ",\"" + GameTable::formatCount(p.values[f]) + "\"";
+        out += ',';
+        if (p.values[HISTORY_FIELDS - 1] >= 0) out += GameTable::formatRating((float)p.values[HISTORY_FIELDS - 1] / 100);
+        out += '\n';
+    }
+    cout << out;
+    if (metrics::enabled) metrics::print(cerr);
+    return 0;
+}
 
-    // Greeting will always print before menu
-    cout << "Howdy, " << currentUser << "! Welcome to the Roblox Games App" << endl;
-    ifstream file("roblox_games.csv");
-    if (!file.is_open()) {
-        cout << "Oops, I can't find any data" << endl;
+// `main --risers [n] [days]`: the n games that gained the most active
+// players over the last `days` days (20 and 7 by default)
+static int runRisers(size_t n, int days) {
+    HistoryStore store;
+    if (!store.open(HISTORY_PATH)) {
+        cerr << "No history yet; add dumps with --ingest <csv> [YYYY-MM-DD]\n";
         return 1;
     }
-    string header;
-    if (!getline(file, header) || header.empty()) {
-        cout << "Oops, I can't find any data" << endl;
+    vector<HistoryRiser> risers;
+    {
+        ScopedOp timed(OP_HISTORY);
+        risers = store.risers(days, n);
+    }
+    cout << "Name,Since,Active before,Active now,Change,Change %\n";
+    for (const HistoryRiser& r : risers) {
+        string name;
+        GameTable::appendName(name, store.name(*r.game));
+        ostringstream line;
+        line << name << "," << formatDay(r.fromDay) << ",\"" << GameTable::formatCount(r.before) << "\",\""
+             << GameTable::formatCount(r.after) << "\",\"" << (r.after < r.before ? "-" : "+")
+             << GameTable::formatCount(llabs(r.after - r.before)) << "\",";
+        if (r.before > 0) line << showpos << fixed << setprecision(1) << 100.0 * (double)(r.after - r.before) / (double)r.before;
+        cout << line.str() << "\n";
+    }
+    if (risers.empty())
+        cerr << "No game has records on " << formatDay(store.latestDay()) << " and " << days << " days before.\n";
+    if (metrics::enabled) metrics::print(cerr);
+    return 0;
+}
+
+#ifdef GAMES_HAVE_SOCKETS
+static GamesServer* runningServer = nullptr;
+static void stopServer(int) {
+    if (runningServer) runningServer->stop();
+}
+#endif
+
+// Daemon mode: `main --serve [socket] [--threads N]` loads the dataset
+// once and answers clients on a Unix socket until SIGINT/SIGTERM
+static int runServe(const string& socketPath, unsigned threads) {
+#ifdef GAMES_HAVE_SOCKETS
+    shared_ptr<const Dataset> data;
+    {
+        ScopedOp timed(OP_LOAD);
+        data = loadDataset("roblox_games.csv");
+    }
+    if (!data) {
+        cerr << "Oops, I can't find any data\n";
         return 1;
     }
-    cout << "Dataset successfully loaded!" << endl;
-    cout << "CSV Columns: " << header << endl;
+    if (!data->table.issues.empty()) cerr << "Warning: " << data->table.issues.summary() << "\n";
+    DatasetWatcher watcher;
+    watcher.start("roblox_games.csv", data);
+    data.reset();
+    UserStore users;
+    users.open("users.csv");
 
-    // Load all rows into memory
-    vector<vector<string>> rows;
-    string line;
-    while (getline(file, line)) {
-        auto fields = splitCSVLine(line);
-        if (!fields.empty()) rows.push_back(fields);
+    GamesServer server(watcher, users, threads);
+    runningServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    cerr << "Serving on " << socketPath << " with " << threads << " workers\n";
+    bool ok = server.run(socketPath);
+    runningServer = nullptr;
+    if (metrics::enabled) metrics::print(cerr);
+    if (!ok) {
+        cerr << "Can't listen on " << socketPath << "\n";
+        return 1;
     }
-    file.close();
+    return 0;
+#else
+    (void)socketPath;
+    (void)threads;
+    cerr << "Server mode needs Unix domain sockets\n";
+    return 1;
+#endif
+}
 
-    vector<const vector<string>*> favorites;
-    auto saveFavoritesToCsv = [&](const vector<const vector<string>*>& favs) {
-        ofstream out_fav(favoritesFile);
-        for (const auto* fields : favs) {
-            for (size_t j = 0; j < fields->size(); ++j) {
-                out_fav << (*fields)[j];
-                if (j + 1 < fields->size()) out_fav << ",";
-            }
-            out_fav << "\n";
+int main(int argc, char* argv[]) {
+    // Prompts still reach the screen before each read since cin is tied to cout
+    ios::sync_with_stdio(false);
+
+    // --metrics (anywhere on the line) or GAMES_METRICS=1: time every
+    // operation and count its rows, bytes and allocations
+    const char* metricsEnv = getenv("GAMES_METRICS");
+    metrics::enabled = metricsEnv && *metricsEnv && string(metricsEnv) != "0";
+    for (int i = 1; i < argc; ++i)
+        if (string(argv[i]) == "--metrics") metrics::enabled = true;
+
+    // --page-size N: rows per page of results, 0 to print them all at once
+    size_t pageSize = defaultPageSize();
+    string socketPath;
+    unsigned threads = max(2u, thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--batch") {
+            return runBatch(i + 1 < argc ? argv[i + 1] : nullptr);
+        } else if (arg == "--ingest" && i + 1 < argc) {
+            return runIngest(argv[i + 1], i + 2 < argc && argv[i + 2][0] != '-' ? argv[i + 2] : "");
+        } else if (arg == "--history" && i + 1 < argc) {
+            int days = 90;
+            if (i + 2 < argc) try { days = max(1, stoi(argv[i + 2])); } catch (...) {}
+            return runHistory(argv[i + 1], days);
+        } else if (arg == "--risers") {
+            size_t n = 20;
+            int days = 7;
+            if (i + 1 < argc) try { n = (size_t)max(1, stoi(argv[i + 1])); } catch (...) {}
+            if (i + 2 < argc) try { days = max(1, stoi(argv[i + 2])); } catch (...) {}
+            return runRisers(n, days);
+        } else if (arg == "--page-size" && i + 1 < argc) {
+            try { pageSize = (size_t)max(0, stoi(argv[++i])); } catch (...) {}
+        } else if (arg == "--serve") {
+            socketPath = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "games.sock";
+        } else if (arg == "--threads" && i + 1 < argc) {
+            try { threads = (unsigned)max(1, stoi(argv[++i])); } catch (...) {}
         }
-    };
+    }
+    if (!socketPath.empty()) return runServe(socketPath, threads);
+    ResultWriter results(cout, pageSize);
+
+    // User login/signup
+    string currentUser;
+    string favoritesFile;
+    if (!authenticateUser(currentUser, favoritesFile)) return 0;
+
+    // Greeting will always print before menu
+    cout << "Howdy, " << currentUser << "! Welcome to the Roblox Games App\n";
+    // Parsed table and search indexes come from roblox_games.csv.snap when
+    // it matches the CSV, so only the first run after a change parses
+    shared_ptr<const Dataset> data;
+    {
+        ScopedOp timed(OP_LOAD);
+        data = loadDataset("roblox_games.csv");
+    }
+    if (!data) {
+        cout << "Oops, I can't find any data\n";
+        return 1;
+    }
+    cout << "Dataset successfully loaded!\n";
+    if (!data->table.issues.empty()) {
+        cout << "Warning: " << data->table.issues.summary() << "\n";
+        for (const string& e : data->table.issues.examples) cout << "  " << e << "\n";
+    }
+    cout << "CSV Columns: " << data->header << "\n";
+    // Picks up new dumps of the CSV in the background
+    DatasetWatcher watcher;
+    watcher.start("roblox_games.csv", data);
+
+    StatsEngine statsEngine;
+    // Reads every favorites_<user>.csv in the background
+    FavoritesGraph favoritesGraph;
+    favoritesGraph.start(data->table);
+
+    // Favorites persist across sessions; every change is one line appended to the log
+    FavoritesStore favoriteStore;
+    bool favoritesOpen;
+    {
+        ScopedOp timed(OP_FAVORITES_READ);
+        favoritesOpen = favoriteStore.open(favoritesFile, data->table);
+    }
+    if (!favoritesOpen) {
+        cout << "Couldn't open " << favoritesFile << ", favorites won't be saved.\n";
+    }
 
     // Main interactive loop
     while (true) {
+        // Switch to a reloaded dataset between commands, never during one
+        shared_ptr<const Dataset> latest = watcher.current();
+        if (latest != data) {
+            favoritesGraph.start(latest->table);   // waits for the old build first
+            favoriteStore.rebind(latest->table);
+            statsEngine = StatsEngine();
+            data = latest;
+            DatasetDiff diff = watcher.lastDiff();
+            cout << "\n[roblox_games.csv reloaded: " << diff.added << " added, " << diff.removed
+                 << " removed, " << diff.changed << " changed]\n";
+        }
+        const GameTable& table = data->table;
+        const NameIndex& nameIndex = data->names;
+        const RelevanceIndex& relevance = data->relevance;
+        const RatingIndex& ratingIndex = data->ratings;
+        const Recommender& recommender = data->recommender;
+
         // Print the greeting and menu each loop
-        cout << "\n Howdy, " << currentUser << "! Welcome to the Roblox Games App " << endl;
+        cout << "\n Howdy, " << currentUser << "! Welcome to the Roblox Games App \n";
         cout << "\n=== MENU ===\n";
         cout << "1) Search by name\n";
         cout << "2) Filter by rating\n";
         cout << "3) View favorites\n";
         cout << "4) Add favorite (by search or exact name)\n";
         cout << "5) Remove favorite\n";
-        cout << "6) Recommendations (Coming Soon)\n";
-        cout << "7) Statistics (Coming Soon)\n";
+        cout << "6) Recommendations\n";
+        cout << "7) Statistics\n";
+        cout << "8) Most favorited games\n";
+        cout << "9) Filter by expression\n";
+        cout << "10) Top games by any column\n";
+        cout << "11) Operation timings (or type stats)\n";
         cout << "0) Save & Exit\n";
         cout << "Choose: ";
 
@@ -160,142 +420,93 @@ int main() {
         getline(cin, choiceStr);
         choiceStr = trim(choiceStr);
         try { choice = stoi(choiceStr); } catch(...) { choice = -1; }
+        if (toLower(choiceStr) == "stats") choice = 11;
 
         if (choice == 1) {
-            cout << "Enter search query: ";
+            cout << "Enter search query (add ~N to allow N typos): ";
             string query;
             getline(cin, query);
             query = trim(query);
-            string queryLower = toLower(query);
-            vector<const vector<string>*> matches;
-            for (const auto& fields : rows) {
-                if (fields.size() > 1) {
-                    string name = toLower(fields[1]);
-                    string nameTrimmed = name;
-                    nameTrimmed.erase(0, nameTrimmed.find_first_not_of(" \t\n\r"));
-                    if (nameTrimmed.empty() || nameTrimmed[0] == '#') continue;
-                    if (name.find(queryLower) != string::npos) {
-                        matches.push_back(&fields);
-                    }
-                }
+            vector<size_t> matches;
+            size_t total = 0;
+            {
+                ScopedOp timed(OP_SEARCH);
+                matches = searchNames(nameIndex, relevance, query, total);
             }
             if (matches.empty()) {
-                cout << "\nNo matches found.\n" << endl;
+                cout << "\nNo matches found.\n\n";
             } else {
-                cout << "\n" << matches.size() << " matches found:\n" << endl;
-                for (const auto* fields : matches) {
-                    for (size_t i = 0; i < fields->size(); ++i) {
-                        cout << (*fields)[i];
-                        if (i + 1 < fields->size()) cout << ",";
-                    }
-                    cout << "\n";
-                }
-                cout << endl;
+                cout << "\n";
+                printMatchCount(matches.size(), total);
+                cout << "\n";
+                results.show(table, matches.size(), [&](size_t k) { return matches[k]; }, cin);
+                cout << "\n";
             }
         }
         else if (choice == 2) {
             // Show the min and max rating before prompting
-            double minRating = 1e9, maxRating = -1e9;
-            for (const auto& fields : rows) {
-                if (fields.size() > 7) {
-                    string ratingStr = fields[7];
-                    ratingStr.erase(0, ratingStr.find_first_not_of(" \t\n\r"));
-                    ratingStr.erase(ratingStr.find_last_not_of(" \t\n\r")+1);
-                    if (!ratingStr.empty()) {
-                        try {
-                            double r = stod(ratingStr);
-                            if (r < minRating) minRating = r;
-                            if (r > maxRating) maxRating = r;
-                        } catch (...) {}
-                    }
-                }
+            if (!ratingIndex.empty()) {
+                cout << "Rating range: " << ratingIndex.minRating() << " to " << ratingIndex.maxRating() << "\n";
             }
-            if (minRating <= maxRating) {
-                cout << "Rating range: " << minRating << " to " << maxRating << endl;
+            cout << "Enter minimum rating value (or a range like 80-90): ";
+            string ratingStr;
+            getline(cin, ratingStr);
+            ratingStr = trim(ratingStr);
+            // Accepts "90", "80-90", "80 to 90" and "between 80 and 90"
+            size_t firstDigit = ratingStr.find_first_of("0123456789.");
+            float lo = 0, hi = INFINITY;
+            if (firstDigit != string::npos) {
+                int got = sscanf(ratingStr.c_str() + firstDigit, "%f%*[^0-9.]%f", &lo, &hi);
+                if (got < 1) lo = 0;
+                if (got < 2) hi = INFINITY;
             }
-            cout << "Enter minimum rating value: ";
-            string minRatingStr;
-            getline(cin, minRatingStr);
-            minRatingStr = trim(minRatingStr);
-            double filterRating = 0;
-            try { filterRating = stod(minRatingStr); } catch (...) { filterRating = 0; }
-            vector<const vector<string>*> matches;
-            for (const auto& fields : rows) {
-                if (fields.size() > 7) {
-                    string ratingStr = fields[7];
-                    ratingStr.erase(0, ratingStr.find_first_not_of(" \t\n\r"));
-                    ratingStr.erase(ratingStr.find_last_not_of(" \t\n\r")+1);
-                    double rating = 0;
-                    try { rating = stod(ratingStr); } catch (...) { rating = 0; }
-                    string nameTrim = fields[1];
-                    nameTrim.erase(0, nameTrim.find_first_not_of(" \t\n\r"));
-                    if (nameTrim.empty() || nameTrim[0] == '#') continue;
-                    if (rating >= filterRating) {
-                        matches.push_back(&fields);
-                    }
-                }
+            RatingIndex::Slice slice;
+            {
+                ScopedOp timed(OP_RATING);
+                slice = ratingIndex.between(lo, hi);
             }
-            if (matches.empty()) {
-                cout << "\nNo matches found.\n" << endl;
+            if (slice.empty()) {
+                cout << "\nNo matches found.\n\n";
             } else {
-                cout << "\n" << matches.size() << " matches found:\n" << endl;
-                for (const auto* fields : matches) {
-                    for (size_t i = 0; i < fields->size(); ++i) {
-                        cout << (*fields)[i];
-                        if (i + 1 < fields->size()) cout << ",";
-                    }
-                    cout << "\n";
-                }
-                cout << endl;
+                cout << "\n" << slice.size() << " matches found:\n\n";
+                // Best rated first, read straight out of the index
+                results.show(table, slice.size(), [&](size_t k) { return (size_t)slice.last[-1 - (ptrdiff_t)k]; }, cin);
+                cout << "\n";
             }
         }
         else if (choice == 3) {
-            ifstream in_fav(favoritesFile);
-            if (!in_fav) {
-                cout << "No favorites file found.\n";
+            cout << "Favorites loaded from " << favoritesFile << ":\n";
+            if (favoriteStore.empty()) {
+                cout << "(No favorites yet)\n";
             } else {
-                string fav_line;
-                bool any = false;
-                cout << "Favorites loaded from " << favoritesFile << ":\n";
-                while (getline(in_fav, fav_line)) {
-                    any = true;
-                    cout << fav_line << "\n";
+                vector<size_t> favorites;
+                {
+                    ScopedOp timed(OP_FAVORITES_READ);
+                    favorites = favoriteStore.rows();
                 }
-                if (!any) cout << "(No favorites yet)\n";
+                results.show(table, favorites.size(), [&](size_t k) { return favorites[k]; }, cin);
+            }
+            if (favoriteStore.missing() > 0) {
+                cout << "(" << favoriteStore.missing() << " more not in the current dataset; kept until they're back)\n";
             }
         }
         else if (choice == 4) {
-            cout << "Add favorite by searching name." << endl;
+            cout << "Add favorite by searching name.\n";
             cout << "Enter search query: ";
             string query;
             getline(cin, query);
             query = trim(query);
-            string queryLower = toLower(query);
-            vector<const vector<string>*> matches;
-            for (const auto& fields : rows) {
-                if (fields.size() > 1) {
-                    string name = toLower(fields[1]);
-                    string nameTrimmed = name;
-                    nameTrimmed.erase(0, nameTrimmed.find_first_not_of(" \t\n\r"));
-                    if (nameTrimmed.empty() || nameTrimmed[0] == '#') continue;
-                    if (name.find(queryLower) != string::npos) {
-                        matches.push_back(&fields);
-                    }
-                }
+            vector<size_t> matches;
+            size_t total = 0;
+            {
+                ScopedOp timed(OP_SEARCH);
+                matches = searchNames(nameIndex, relevance, query, total);
             }
             if (matches.empty()) {
                 cout << "No matches found.\n";
             } else {
-                cout << matches.size() << " matches found:\n";
-                for (size_t i = 0; i < matches.size(); ++i) {
-                    cout << i+1 << ") ";
-                    const auto* fields = matches[i];
-                    for (size_t j = 0; j < fields->size(); ++j) {
-                        cout << (*fields)[j];
-                        if (j + 1 < fields->size()) cout << ",";
-                    }
-                    cout << "\n";
-                }
+                printMatchCount(matches.size(), total);
+                results.show(table, matches.size(), [&](size_t k) { return matches[k]; }, cin, true);
                 cout << "Pick number to favorite (0 to cancel): ";
                 string pickStr;
                 getline(cin, pickStr);
@@ -305,36 +516,28 @@ int main() {
                 if (pick <= 0 || (size_t)pick > matches.size()) {
                     cout << "Cancelled.\n";
                 } else {
-                    const auto* selected = matches[pick-1];
-                    // Prevent duplicates
-                    bool exists = false;
-                    for (const auto* f : favorites) {
-                        if ((*f)[1] == (*selected)[1]) { exists = true; break; }
+                    size_t selected = matches[pick-1];
+                    // add() refuses duplicates
+                    bool added;
+                    {
+                        ScopedOp timed(OP_FAVORITES_WRITE);
+                        added = favoriteStore.add(selected);
                     }
-                    if (!exists) {
-                        favorites.push_back(selected);
-                        cout << "Added to favorites: " << (*selected)[1] << "\n";
-                        saveFavoritesToCsv(favorites);
+                    if (added) {
+                        cout << "Added to favorites: " << table.name(selected) << "\n";
                     } else {
-                        cout << "Already in favorites: " << (*selected)[1] << "\n";
+                        cout << "Already in favorites: " << table.name(selected) << "\n";
                     }
                 }
             }
         }
         else if (choice == 5) {
+            vector<size_t> favorites = favoriteStore.rows();
             if (favorites.empty()) {
-                cout << "(No favorites in this session—restart and add favorites)\n";
+                cout << "(No favorites yet)\n";
             } else {
-                cout << "Favorites in this session:" << endl;
-                for (size_t i = 0; i < favorites.size(); ++i) {
-                    cout << i+1 << ") ";
-                    const auto* fields = favorites[i];
-                    for (size_t j = 0; j < fields->size(); ++j) {
-                        cout << (*fields)[j];
-                        if (j + 1 < fields->size()) cout << ",";
-                    }
-                    cout << "\n";
-                }
+                cout << "Your favorites:\n";
+                results.show(table, favorites.size(), [&](size_t k) { return favorites[k]; }, cin, true);
                 cout << "Enter number to remove (0 to cancel): ";
                 string removeStr;
                 getline(cin, removeStr);
@@ -344,25 +547,124 @@ int main() {
                 if (n <= 0 || (size_t)n > favorites.size()) {
                     cout << "Cancelled.\n";
                 } else {
-                    string removedName = (*favorites[n-1])[1];
-                    favorites.erase(favorites.begin() + (n-1));
-                    saveFavoritesToCsv(favorites);
+                    string removedName(table.name(favorites[n-1]));
+                    ScopedOp timed(OP_FAVORITES_WRITE);
+                    favoriteStore.remove(favorites[n-1]);
                     cout << "Successfully removed from favorites: " << removedName << "\n";
                 }
             }
         }
         else if (choice == 6) {
-            cout << "Feature coming soon: Recommendations is in the works and will be released soon!\n";
+            vector<size_t> favorites = favoriteStore.rows();
+            if (favorites.empty()) {
+                cout << "Add some favorites first so we know what you like!\n";
+            } else {
+                vector<Recommendation> recs;
+                {
+                    ScopedOp timed(OP_RECOMMEND);
+                    recs = recommender.recommend(favorites, 10);
+                }
+                cout << "\nBecause you liked " << table.name(favorites.back()) << ":\n\n";
+                for (size_t i = 0; i < recs.size(); ++i) {
+                    cout << i+1 << ") ";
+                    table.writeRow(cout, recs[i].row);
+                    cout << "  (match " << (int)std::lround(recs[i].score * 100) << "%)\n";
+                }
+                // What other players paired with the same game
+                if (favoritesGraph.ready()) {
+                    auto also = favoritesGraph.alsoFavorited(favorites.back(), 5);
+                    if (!also.empty()) {
+                        cout << "\nPlayers who favorited " << table.name(favorites.back()) << " also favorited:\n";
+                        for (const auto& e : also) {
+                            cout << "- " << table.name(e.row) << " (" << e.count << " players)\n";
+                        }
+                    }
+                }
+            }
+        }
+        else if (choice == 8) {
+            if (!favoritesGraph.ready()) {
+                cout << "Still counting everyone's favorites, try again in a moment.\n";
+            } else {
+                ScopedOp timed(OP_MOST_FAVORITED);
+                auto top = favoritesGraph.mostFavorited(10);
+                if (top.empty()) {
+                    cout << "Nobody has any favorites yet.\n";
+                } else {
+                    cout << "\nMost favorited across " << favoritesGraph.users() << " players:\n";
+                    for (size_t i = 0; i < top.size(); ++i) {
+                        cout << i+1 << ") " << table.name(top[i].row) << " (" << top[i].count << " players)\n";
+                    }
+                }
+            }
         }
         else if (choice == 7) {
-            cout << "Feature coming soon: Statistics is in the works and will be released soon!\n";
+            ScopedOp timed(OP_STATISTICS);
+            StatsEngine::print(cout, statsEngine.get(table));
+        }
+        else if (choice == 9) {
+            cout << "Columns: rank, name, active, visits, favourites, likes, dislikes, rating\n";
+            cout << "Example: rating >= 90 and active > 10k and not name ~ \"obby\"\n";
+            cout << "Enter filter: ";
+            string expr;
+            getline(cin, expr);
+            FilterExpr filter;
+            string error;
+            vector<size_t> matches;
+            bool compiled;
+            {
+                ScopedOp timed(OP_FILTER);
+                compiled = filter.compile(expr, table, nameIndex, error);
+                if (compiled) matches = filter.run();
+            }
+            if (!compiled) {
+                cout << "Can't use that filter: " << error << "\n";
+            } else {
+                if (matches.empty()) {
+                    cout << "\nNo matches found.\n\n";
+                } else {
+                    cout << "\n" << matches.size() << " matches found:\n\n";
+                    results.show(table, matches.size(), [&](size_t k) { return matches[k]; }, cin);
+                    cout << "\n";
+                }
+            }
+        }
+        else if (choice == 10) {
+            cout << "Sort by rank, active, visits, favourites, likes, dislikes, rating or ratio (likes share).\n";
+            cout << "Examples: \"likes 20\", \"ratio 10 asc\", \"rating:desc,visits:asc 20\"\n";
+            cout << "Enter leaderboard: ";
+            string spec;
+            getline(cin, spec);
+            vector<TopIndex::Key> keys;
+            size_t n = 0;
+            string error;
+            if (!TopIndex::parseQuery(trim(spec), keys, n, error)) {
+                cout << "Can't sort that way: " << error << "\n";
+            } else {
+                vector<size_t> leaders;
+                {
+                    ScopedOp timed(OP_TOP);
+                    leaders = data->tops.top(table, keys, n);
+                }
+                cout << "\n";
+                results.show(table, leaders.size(), [&](size_t k) { return leaders[k]; }, cin, true);
+            }
+        }
+        else if (choice == 11) {
+            cout << "\n";
+            metrics::print(cout);
         }
         else if (choice == 0) {
-            cout << "Goodbye!" << endl;
+            // Exit-time dump of everything this session timed
+            if (metrics::enabled) {
+                cout << "\nOperation timings for this session:\n";
+                metrics::print(cout);
+            }
+            cout << "Goodbye!\n";
             break;
         }
         else {
-            cout << "Unknown or unimplemented option." << endl;
+            cout << "Unknown or unimplemented option.\n";
         }
     }
     return 0;
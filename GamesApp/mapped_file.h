@@ -0,0 +1,92 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "metrics.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GAMES_HAVE_MMAP 1
+#endif
+
+// Read-only view of a whole file. Uses mmap where available so loading a
+// large dump doesn't copy it; falls back to reading it into a buffer.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef GAMES_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+        size_ = (size_t)st.st_size;
+        if (size_ > 0) {
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) { ::close(fd); size_ = 0; return false; }
+            // Every user starts with a front-to-back pass (parse or hash);
+            // ones that keep the mapping call endSequentialScan after it
+            madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+            mapped_ = true;
+        }
+        ::close(fd);
+        metrics::addBytes(size_);
+        return true;
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        in.seekg(0, std::ios::end);
+        buffer_.resize((size_t)in.tellg());
+        in.seekg(0);
+        in.read(buffer_.data(), (std::streamsize)buffer_.size());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+        metrics::addBytes(size_);
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef GAMES_HAVE_MMAP
+        if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+        mapped_ = false;
+        data_ = nullptr;
+        size_ = 0;
+        buffer_.clear();
+    }
+
+    // The first pass is over and reads from here on are random (names
+    // looked up by row), so drop the sequential read-ahead and
+    // drop-behind hint. Names already read stay cached
+    void endSequentialScan() const {
+#ifdef GAMES_HAVE_MMAP
+        if (mapped_) madvise(const_cast<char*>(data_), size_, MADV_NORMAL);
+#endif
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<char> buffer_;
+};
+
+#endif
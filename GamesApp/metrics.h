@@ -0,0 +1,187 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+
+// Where the time goes, per operation: a latency histogram plus rows
+// scanned, bytes read and allocations made while the operation ran.
+//
+// Off unless main is started with --metrics or GAMES_METRICS=1. While off,
+// a ScopedOp and each counter call cost one load of a bool that never
+// changes and a branch that is always predicted, so they can sit on hot
+// paths. The switch is flipped once at startup, before any thread exists.
+
+enum MetricOp {
+    OP_LOGIN, OP_LOAD, OP_RELOAD, OP_SEARCH, OP_RATING, OP_FILTER, OP_TOP,
+    OP_FAVORITES_READ, OP_FAVORITES_WRITE, OP_RECOMMEND, OP_STATISTICS,
+    OP_MOST_FAVORITED, OP_HISTORY, METRIC_OP_COUNT
+};
+
+inline const char* metricOpName(int op) {
+    static const char* const names[METRIC_OP_COUNT] = {
+        "login", "load", "reload", "search", "rating", "filter", "top",
+        "favorites read", "favorites write", "recommend", "statistics", "most favorited", "history"};
+    return op >= 0 && op < METRIC_OP_COUNT ? names[op] : "?";
+}
+
+// HDR-style histogram of nanoseconds: exact below 16, then 16 buckets per
+// power of two, so any recorded value is within 1/16 (~6%) of its
+// bucket's bounds from 1 ns up to centuries. Lock-free; server workers
+// record into the same one.
+class LatencyHistogram {
+public:
+    static const unsigned SUB_BITS = 4;
+    static const unsigned SUB = 1u << SUB_BITS;
+    static const size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    void record(uint64_t ns) {
+        buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = max_.load(std::memory_order_relaxed);
+        while (ns > seen && !max_.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return total.load(std::memory_order_relaxed); }
+
+    // Upper bound of the bucket holding the q-th value, capped at the max
+    uint64_t percentile(double q) const {
+        uint64_t n = count();
+        if (n == 0) return 0;
+        uint64_t rank = (uint64_t)(q * (double)(n - 1)) + 1, seen = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            seen += buckets[b].load(std::memory_order_relaxed);
+            if (seen >= rank) return std::min(upperBound(b), max());
+        }
+        return max();
+    }
+
+    static size_t bucketOf(uint64_t v) {
+        if (v < SUB) return (size_t)v;
+        unsigned shift = 63 - (unsigned)__builtin_clzll(v) - SUB_BITS;
+        return (size_t)(shift + 1) * SUB + (size_t)((v >> shift) & (SUB - 1));
+    }
+
+    static uint64_t upperBound(size_t b) {
+        if (b < SUB) return b;
+        unsigned shift = (unsigned)(b / SUB) - 1;
+        return ((SUB + b % SUB + 1) << shift) - 1;
+    }
+
+private:
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0}, total{0}, max_{0};
+};
+
+struct OpMetrics {
+    LatencyHistogram latency;
+    std::atomic<uint64_t> rows{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> allocations{0};
+};
+
+namespace metrics {
+
+inline bool enabled = false;
+inline OpMetrics ops[METRIC_OP_COUNT];
+inline thread_local int current = -1;   // innermost ScopedOp on this thread
+
+inline void addRows(uint64_t n) {
+    if (enabled && current >= 0) ops[current].rows.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void addBytes(uint64_t n) {
+    if (enabled && current >= 0) ops[current].bytes.fetch_add(n, std::memory_order_relaxed);
+}
+
+// Called from the replacement operator new in main.cpp
+inline void noteAllocation() {
+    if (enabled && current >= 0) ops[current].allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline std::string formatNanos(uint64_t ns) {
+    char buf[32];
+    if (ns < 10000) std::snprintf(buf, sizeof(buf), "%lluns", (unsigned long long)ns);
+    else if (ns < 10000000) std::snprintf(buf, sizeof(buf), "%.1fus", (double)ns / 1e3);
+    else if (ns < 10000000000ull) std::snprintf(buf, sizeof(buf), "%.1fms", (double)ns / 1e6);
+    else std::snprintf(buf, sizeof(buf), "%.2fs", (double)ns / 1e9);
+    return buf;
+}
+
+// Table of every operation that ran at least once
+inline void print(std::ostream& out) {
+    if (!enabled) {
+        out << "Operation timings are off; start with --metrics or GAMES_METRICS=1.\n";
+        return;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-16s %7s %9s %9s %9s %10s %11s %10s\n", "operation", "count", "p50",
+                  "p99", "max", "rows/op", "bytes/op", "allocs/op");
+    out << line;
+    bool any = false;
+    for (int op = 0; op < METRIC_OP_COUNT; ++op) {
+        const OpMetrics& m = ops[op];
+        uint64_t n = m.latency.count();
+        if (n == 0) continue;
+        any = true;
+        std::snprintf(line, sizeof(line), "%-16s %7llu %9s %9s %9s %10.0f %11.0f %10.1f\n", metricOpName(op),
+                      (unsigned long long)n, formatNanos(m.latency.percentile(0.50)).c_str(),
+                      formatNanos(m.latency.percentile(0.99)).c_str(), formatNanos(m.latency.max()).c_str(),
+                      (double)m.rows / (double)n, (double)m.bytes / (double)n, (double)m.allocations / (double)n);
+        out << line;
+    }
+    if (!any) out << "(nothing timed yet)\n";
+}
+
+// Same numbers as key=value CSV lines, for batch mode's timing log
+inline void printLines(std::ostream& out) {
+    for (int op = 0; op < METRIC_OP_COUNT && enabled; ++op) {
+        const OpMetrics& m = ops[op];
+        uint64_t n = m.latency.count();
+        if (n == 0) continue;
+        out << "metric,op=" << metricOpName(op) << ",count=" << n
+            << ",p50_us=" << (double)m.latency.percentile(0.50) / 1e3
+            << ",p99_us=" << (double)m.latency.percentile(0.99) / 1e3
+            << ",max_us=" << (double)m.latency.max() / 1e3 << ",rows=" << m.rows.load()
+            << ",bytes=" << m.bytes.load() << ",allocs=" << m.allocations.load() << "\n";
+    }
+}
+
+} // namespace metrics
+
+// Times the enclosing scope as one `op`, and makes it the operation the
+// counters are charged to. Nested scopes charge the innermost one.
+class ScopedOp {
+public:
+    explicit ScopedOp(MetricOp op) {
+        if (!metrics::enabled) return;
+        id = op;
+        outer = metrics::current;
+        metrics::current = op;
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedOp() {
+        if (id < 0) return;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        metrics::ops[id].latency.record((uint64_t)ns.count());
+        metrics::current = outer;
+    }
+
+    ScopedOp(const ScopedOp&) = delete;
+    ScopedOp& operator=(const ScopedOp&) = delete;
+
+private:
+    int id = -1;
+    int outer = -1;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "game_table.h"
+#include "case_fold.h"
+#include "fuzzy.h"
+#include "metrics.h"
+
+// Trigram index over the table's case-folded names for substring search.
+// Each 3-byte sequence maps to the sorted list of rows containing it; a
+// query intersects the lists for its own trigrams and then checks the few
+// rows left with a real substring match.
+class NameIndex {
+public:
+    void build(const GameTable& table) {
+        source = &table;
+        rows = table.size();
+        listed.assign(rows, 0);
+
+        std::vector<uint64_t> pairs;
+        for (size_t i = 0; i < rows; ++i) {
+            listed[i] = table.listed(i);
+            std::string_view n = table.foldedName(i);
+            for (size_t p = 0; p + 3 <= n.size(); ++p)
+                pairs.push_back((uint64_t)trigram(&n[p]) << 32 | i);
+        }
+
+        // Pairs come out in row order, so a stable radix sort on the 24-bit
+        // trigram groups each posting list with its rows already ascending
+        radixSortByTrigram(pairs);
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+        keys.clear();
+        offsets.clear();
+        postings.resize(pairs.size());
+        for (size_t k = 0; k < pairs.size(); ++k) {
+            uint32_t tri = (uint32_t)(pairs[k] >> 32);
+            if (keys.empty() || keys.back() != tri) {
+                keys.push_back(tri);
+                offsets.push_back((uint64_t)k);
+            }
+            postings[k] = (uint32_t)pairs[k];
+        }
+        offsets.push_back((uint64_t)pairs.size());
+    }
+
+    size_t size() const { return rows; }
+
+    // Snapshot support (see snapshot.h)
+    template <class Writer>
+    void saveTo(Writer& w) const {
+        w.put("trigramListed", listed);
+        w.put("trigramKeys", keys);
+        w.put("trigramOffsets", offsets);
+        w.put("trigramPostings", postings);
+    }
+
+    template <class Reader>
+    bool loadFrom(const Reader& r, const GameTable& table) {
+        if (!r.get("trigramListed", listed) || !r.get("trigramKeys", keys) ||
+            !r.get("trigramOffsets", offsets) || !r.get("trigramPostings", postings))
+            return false;
+        if (offsets.size() != keys.size() + 1 || offsets.back() != postings.size()) return false;
+        source = &table;
+        rows = listed.size();
+        return true;
+    }
+
+    // Rows (in file order) whose name contains `query`, ignoring case.
+    // Names starting with '#' are left out like the menus always did.
+    std::vector<size_t> search(const std::string& query) const {
+        std::string q = foldCase(query);
+        std::vector<size_t> matches;
+
+        // Too short to have a trigram: fall back to scanning the folded names
+        if (q.size() < 3) {
+            for (size_t i = 0; i < rows; ++i)
+                if (listed[i] && source->foldedName(i).find(q) != std::string_view::npos) matches.push_back(i);
+            metrics::addRows(rows);
+            return matches;
+        }
+
+        std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+        for (size_t p = 0; p + 3 <= q.size(); ++p) {
+            auto list = postingList(trigram(&q[p]));
+            if (list.first == list.second) return matches;
+            lists.push_back(list);
+        }
+        std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+            return (a.second - a.first) < (b.second - b.first);
+        });
+        lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+        // Start from the rarest trigram and narrow it down with the rest
+        std::vector<uint32_t> candidates(lists[0].first, lists[0].second);
+        for (size_t l = 1; l < lists.size() && !candidates.empty(); ++l) {
+            size_t out = 0;
+            const uint32_t* lo = lists[l].first;
+            for (uint32_t row : candidates) {
+                lo = std::lower_bound(lo, lists[l].second, row);
+                if (lo == lists[l].second) break;
+                if (*lo == row) candidates[out++] = row;
+            }
+            candidates.resize(out);
+        }
+
+        for (uint32_t row : candidates)
+            if (listed[row] && source->foldedName(row).find(q) != std::string_view::npos) matches.push_back(row);
+        metrics::addRows(candidates.size());
+        return matches;
+    }
+
+    struct FuzzyMatch {
+        size_t row;
+        int distance;
+    };
+
+    // Default typo budget for a query: about one edit per four bytes, 1 to 3
+    static int defaultMaxDistance(const std::string& query) {
+        return std::max(1, std::min(3, (int)foldCase(query).size() / 4));
+    }
+
+    // Rows whose name contains `query` with at most maxDistance typos
+    // (insertions, deletions, substitutions), closest first and file order
+    // within a distance. Queries longer than 64 bytes are cut to 64.
+    //
+    // Candidates come from the trigram index first. A substring within k
+    // edits of the query still shares all but at most 3k of the query's
+    // distinct trigrams, since one edit touches at most three of them, so
+    // rows sharing fewer can't match and never reach the edit distance.
+    std::vector<FuzzyMatch> fuzzySearch(const std::string& query, int maxDistance) const {
+        std::string q = foldCase(query);
+        if (q.size() > MyersPattern::MAX_LENGTH) q.resize(MyersPattern::MAX_LENGTH);
+        MyersPattern pattern(q);
+        std::vector<FuzzyMatch> matches;
+        if (q.empty() || maxDistance < 0) return matches;
+
+        size_t scanned = 0;
+        auto consider = [&](size_t row) {
+            ++scanned;
+            if (!listed[row]) return;
+            int d = pattern.bestDistance(source->foldedName(row));
+            if (d <= maxDistance) matches.push_back({row, d});
+        };
+
+        std::vector<uint32_t> grams;
+        for (size_t p = 0; p + 3 <= q.size(); ++p) grams.push_back(trigram(&q[p]));
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        long need = (long)grams.size() - 3L * maxDistance;
+
+        if (need <= 0) {
+            // Too short or too loose for the bound to rule anything out
+            for (size_t i = 0; i < rows; ++i) consider(i);
+        } else {
+            std::vector<uint8_t> hits(rows, 0);
+            std::vector<uint32_t> candidates;
+            for (uint32_t g : grams) {
+                auto list = postingList(g);
+                for (const uint32_t* r = list.first; r != list.second; ++r)
+                    if (++hits[*r] == need) candidates.push_back(*r);
+            }
+            std::sort(candidates.begin(), candidates.end());
+            for (uint32_t row : candidates) consider(row);
+        }
+        metrics::addRows(scanned);
+
+        std::stable_sort(matches.begin(), matches.end(),
+                         [](const FuzzyMatch& a, const FuzzyMatch& b) { return a.distance < b.distance; });
+        return matches;
+    }
+
+private:
+    const GameTable* source = nullptr;
+    size_t rows = 0;
+    std::vector<char> listed;
+    std::vector<uint32_t> keys;      // sorted distinct trigrams
+    std::vector<uint64_t> offsets;   // keys[k]'s rows are postings[offsets[k], offsets[k+1])
+    std::vector<uint32_t> postings;
+
+    static void radixSortByTrigram(std::vector<uint64_t>& pairs) {
+        std::vector<uint64_t> tmp(pairs.size());
+        for (int shift = 32; shift < 56; shift += 12) {
+            std::vector<size_t> count(4097, 0);
+            for (uint64_t v : pairs) ++count[((v >> shift) & 4095) + 1];
+            for (size_t b = 1; b < count.size(); ++b) count[b] += count[b - 1];
+            for (uint64_t v : pairs) tmp[count[(v >> shift) & 4095]++] = v;
+            pairs.swap(tmp);
+        }
+    }
+
+    static uint32_t trigram(const char* p) {
+        return (uint32_t)(unsigned char)p[0] << 16 | (uint32_t)(unsigned char)p[1] << 8 | (unsigned char)p[2];
+    }
+
+    std::pair<const uint32_t*, const uint32_t*> postingList(uint32_t tri) const {
+        auto it = std::lower_bound(keys.begin(), keys.end(), tri);
+        if (it == keys.end() || *it != tri) return {nullptr, nullptr};
+        size_t k = (size_t)(it - keys.begin());
+        return {postings.data() + offsets[k], postings.data() + offsets[k + 1]};
+    }
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define GAMES_HAVE_SOCKETS 1
+#endif
+
+// Wire protocol for `main --serve`. A request is one line of text, the
+// same commands batch mode takes plus session ones (see server.h). Each
+// reply is either
+//   OK <bytes>\n<bytes of payload>
+//   ERR <message>\n
+// Payloads are CSV rows or plain text, and the length prefix means a
+// name with a newline in it can't desync the stream.
+
+#ifdef GAMES_HAVE_SOCKETS
+
+inline bool writeAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::send(fd, p, n, 0);
+        if (w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+inline std::string okReply(std::string_view body) {
+    std::string out = "OK " + std::to_string(body.size()) + "\n";
+    out.append(body.data(), body.size());
+    return out;
+}
+
+inline std::string errorReply(const std::string& message) {
+    std::string out = "ERR " + message;
+    for (char& c : out) if (c == '\n') c = ' ';
+    return out + "\n";
+}
+
+inline bool fillSocketAddress(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Blocking client for one connection, used by the load generator
+class GamesClient {
+public:
+    GamesClient() = default;
+    GamesClient(const GamesClient&) = delete;
+    GamesClient& operator=(const GamesClient&) = delete;
+    ~GamesClient() { close(); }
+
+    bool connect(const std::string& path) {
+        close();
+        sockaddr_un addr;
+        if (!fillSocketAddress(path, addr)) return false;
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        buffered.clear();
+    }
+
+    // Send one command and wait for its reply. Returns false if the
+    // connection broke; ok says whether the server answered OK or ERR,
+    // and body is the payload or the error message.
+    bool request(const std::string& line, bool& ok, std::string& body) {
+        std::string msg = line + "\n";
+        if (fd < 0 || !writeAll(fd, msg.data(), msg.size())) return false;
+        std::string status;
+        if (!readLine(status)) return false;
+        if (status.rfind("OK ", 0) == 0) {
+            ok = true;
+            size_t bytes = std::strtoull(status.c_str() + 3, nullptr, 10);
+            return readBytes(bytes, body);
+        }
+        ok = false;
+        body = status.size() > 4 ? status.substr(4) : status;
+        return true;
+    }
+
+private:
+    int fd = -1;
+    std::string buffered;
+
+    bool fill() {
+        char chunk[65536];
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buffered.append(chunk, (size_t)n);
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        size_t nl;
+        while ((nl = buffered.find('\n')) == std::string::npos)
+            if (!fill()) return false;
+        line = buffered.substr(0, nl);
+        buffered.erase(0, nl + 1);
+        return true;
+    }
+
+    bool readBytes(size_t n, std::string& out) {
+        while (buffered.size() < n)
+            if (!fill()) return false;
+        out = buffered.substr(0, n);
+        buffered.erase(0, n);
+        return true;
+    }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef RATING_INDEX_H
+#define RATING_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include "game_table.h"
+#include "metrics.h"
+
+// Rows sorted by rating, built once at load. A rating filter is then a
+// binary search plus a contiguous slice of this permutation.
+class RatingIndex {
+public:
+    // A run of row indexes inside the index, lowest rating first
+    struct Slice {
+        const uint32_t* first = nullptr;
+        const uint32_t* last = nullptr;
+        size_t size() const { return (size_t)(last - first); }
+        bool empty() const { return first == last; }
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+    };
+
+    void build(const GameTable& table) {
+        order.clear();
+        for (size_t i = 0; i < table.size(); ++i)
+            if (table.listed(i) && !std::isnan(table.rating[i])) order.push_back((uint32_t)i);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return table.rating[a] < table.rating[b];
+        });
+        // Keep the sorted keys next to each other for the binary search
+        sorted.resize(order.size());
+        for (size_t k = 0; k < order.size(); ++k) sorted[k] = table.rating[order[k]];
+    }
+
+    // Snapshot support (see snapshot.h)
+    template <class Writer>
+    void saveTo(Writer& w) const {
+        w.put("ratingOrder", order);
+        w.put("ratingSorted", sorted);
+    }
+
+    template <class Reader>
+    bool loadFrom(const Reader& r) {
+        return r.get("ratingOrder", order) && r.get("ratingSorted", sorted) && order.size() == sorted.size();
+    }
+
+    bool empty() const { return order.empty(); }
+    float minRating() const { return sorted.front(); }
+    float maxRating() const { return sorted.back(); }
+
+    // Rows with rating >= lo
+    Slice atLeast(float lo) const {
+        return between(lo, INFINITY);
+    }
+
+    // Rows with lo <= rating <= hi. Bounds given the wrong way round
+    // ("90-80") are swapped rather than matching nothing
+    Slice between(float lo, float hi) const {
+        if (lo > hi) std::swap(lo, hi);
+        size_t a = (size_t)(std::lower_bound(sorted.begin(), sorted.end(), lo) - sorted.begin());
+        size_t b = (size_t)(std::upper_bound(sorted.begin(), sorted.end(), hi) - sorted.begin());
+        if (b < a) b = a;
+        metrics::addRows(b - a);
+        return Slice{order.data() + a, order.data() + b};
+    }
+
+private:
+    std::vector<uint32_t> order;
+    std::vector<float> sorted;
+};
+
+#endif
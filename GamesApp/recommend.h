@@ -0,0 +1,211 @@
+#ifndef RECOMMEND_H
+#define RECOMMEND_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "game_table.h"
+#include "metrics.h"
+
+// One recommended game and how close it is to the user's taste (cosine, -1..1)
+struct Recommendation {
+    size_t row;
+    float score;
+};
+
+// Content-based recommender. Every game gets a fixed-size, L2-normalized
+// feature vector built at load (stats columns plus hashed name tokens),
+// stored row-major in one float matrix. A user's profile is the mean of
+// their favorites' vectors, and results are the top-k dot products.
+// For big catalogs an LSH index narrows the candidates first.
+class Recommender {
+public:
+    static const size_t DIMS = 64;          // 256 bytes per game
+    static const size_t NUMERIC_DIMS = 4;   // like ratio, log visits, log active, rating
+    static const size_t LSH_BITS = 12;
+    static const size_t LSH_TABLES = 4;
+
+    void build(const GameTable& table, bool withLsh = false) {
+        rows = table.size();
+        features.assign(rows * DIMS, 0.0f);
+        listed.assign(rows, 0);
+        sameName.assign(rows, 0);
+
+        // The dumps sometimes list a game twice; only recommend it once.
+        // Maps each game's key to the first row carrying it
+        std::unordered_map<std::string_view, uint32_t> firstRow;
+
+        // z-score the numeric columns so no one column dominates
+        std::vector<float> raw(rows * NUMERIC_DIMS);
+        double mean[NUMERIC_DIMS] = {0}, sq[NUMERIC_DIMS] = {0};
+        for (size_t i = 0; i < rows; ++i) {
+            double likes = (double)table.likes[i], dislikes = (double)table.dislikes[i];
+            float r = table.rating[i];
+            float* f = &raw[i * NUMERIC_DIMS];
+            f[0] = (float)(likes + dislikes > 0 ? likes / (likes + dislikes) : 0.5);
+            f[1] = (float)std::log1p((double)std::max<int64_t>(0, table.visits[i]));
+            f[2] = (float)std::log1p((double)std::max<int64_t>(0, table.active[i]));
+            f[3] = std::isnan(r) ? 0.0f : r / 100.0f;
+            for (size_t d = 0; d < NUMERIC_DIMS; ++d) { mean[d] += f[d]; sq[d] += (double)f[d] * f[d]; }
+            auto seen = firstRow.emplace(table.key(i), (uint32_t)i);
+            sameName[i] = seen.first->second;
+            listed[i] = table.listed(i) && seen.second;
+        }
+        float mu[NUMERIC_DIMS], sigma[NUMERIC_DIMS];
+        for (size_t d = 0; d < NUMERIC_DIMS; ++d) {
+            mu[d] = rows ? (float)(mean[d] / (double)rows) : 0.0f;
+            double var = rows ? sq[d] / (double)rows - (double)mu[d] * mu[d] : 0.0;
+            sigma[d] = var > 1e-12 ? (float)std::sqrt(var) : 1.0f;
+        }
+
+        // Document frequency per name token, so rare words count for more
+        docFreq.clear();
+        for (size_t i = 0; i < rows; ++i)
+            forEachToken(table.foldedName(i), [&](size_t h) { ++docFreq[h]; });
+
+        for (size_t i = 0; i < rows; ++i) {
+            float* v = &features[i * DIMS];
+            for (size_t d = 0; d < NUMERIC_DIMS; ++d) {
+                float z = (raw[i * NUMERIC_DIMS + d] - mu[d]) / sigma[d];
+                v[d] = std::max(-3.0f, std::min(3.0f, z)) / 3.0f;
+            }
+            hashNameTokens(table.foldedName(i), v + NUMERIC_DIMS);
+            normalize(v);
+        }
+
+        docFreq.clear();
+        lsh.clear();
+        if (withLsh) buildLsh();
+    }
+
+    bool approximate() const { return !lsh.empty(); }
+
+    // Top k games most similar to the given favorites, best first.
+    // Favorites themselves (under any of their listings) and unlisted
+    // names are never returned.
+    std::vector<Recommendation> recommend(const std::vector<size_t>& favorites, size_t k) const {
+        std::vector<Recommendation> out;
+        if (favorites.empty() || rows == 0) return out;
+
+        float profile[DIMS] = {0};
+        for (size_t row : favorites)
+            for (size_t d = 0; d < DIMS; ++d) profile[d] += features[row * DIMS + d];
+        normalize(profile);
+        std::unordered_set<uint32_t> skip;
+        for (size_t row : favorites) skip.insert(sameName[row]);
+
+        // Min-heap of the best k so far; the root is the one to beat
+        auto worse = [](const Recommendation& a, const Recommendation& b) { return a.score > b.score; };
+        std::priority_queue<Recommendation, std::vector<Recommendation>, decltype(worse)> heap(worse);
+        size_t scanned = 0;
+        auto consider = [&](size_t row) {
+            ++scanned;
+            if (!listed[row] || skip.count(sameName[row])) return;
+            float score = dot(profile, &features[row * DIMS]);
+            if (heap.size() < k) heap.push({row, score});
+            else if (score > heap.top().score) { heap.pop(); heap.push({row, score}); }
+        };
+
+        if (approximate()) {
+            std::vector<char> seen(rows, 0);
+            for (size_t t = 0; t < LSH_TABLES; ++t) {
+                auto it = lsh[t].find(signature(profile, t));
+                if (it == lsh[t].end()) continue;
+                for (uint32_t row : it->second)
+                    if (!seen[row]) { seen[row] = 1; consider(row); }
+            }
+        }
+        // Exact scan, also the fallback when the buckets came up short
+        if (heap.size() < k) {
+            while (!heap.empty()) heap.pop();
+            for (size_t row = 0; row < rows; ++row) consider(row);
+        }
+
+        metrics::addRows(scanned);
+        while (!heap.empty()) { out.push_back(heap.top()); heap.pop(); }
+        std::reverse(out.begin(), out.end());
+        return out;
+    }
+
+private:
+    size_t rows = 0;
+    std::vector<float> features;
+    std::vector<char> listed;
+    std::vector<uint32_t> sameName;   // first row with the same key (GameTable::key)
+    std::unordered_map<size_t, uint32_t> docFreq;   // only used during build
+    std::vector<float> planes;   // LSH_TABLES * LSH_BITS random hyperplanes
+    std::vector<std::unordered_map<uint32_t, std::vector<uint32_t>>> lsh;
+
+    static float dot(const float* a, const float* b) {
+        float s = 0;
+        for (size_t d = 0; d < DIMS; ++d) s += a[d] * b[d];
+        return s;
+    }
+
+    static void normalize(float* v) {
+        float n = std::sqrt(dot(v, v));
+        if (n > 0) for (size_t d = 0; d < DIMS; ++d) v[d] /= n;
+    }
+
+    // Calls f with the hash of each word in a folded name. Words are runs of
+    // ASCII letters/digits or non-ASCII bytes, so emoji count as words too.
+    template <class F>
+    static void forEachToken(std::string_view name, F f) {
+        size_t start = 0;
+        for (size_t i = 0; i <= name.size(); ++i) {
+            unsigned char c = i < name.size() ? (unsigned char)name[i] : ' ';
+            bool word = c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z');
+            if (word) continue;
+            if (i > start) f(std::hash<std::string_view>()(name.substr(start, i - start)));
+            start = i + 1;
+        }
+    }
+
+    // Feature hashing: each word of the name adds +-idf to one of the name
+    // dimensions, then the block is scaled to sit alongside the numeric part
+    void hashNameTokens(std::string_view name, float* out) const {
+        const size_t dims = DIMS - NUMERIC_DIMS;
+        forEachToken(name, [&](size_t h) {
+            auto it = docFreq.find(h);
+            float idf = (float)std::log((double)(rows + 1) / (double)(it == docFreq.end() ? 1 : it->second));
+            out[h % dims] += ((h >> 32) & 1) ? idf : -idf;
+        });
+        float norm = 0;
+        for (size_t d = 0; d < dims; ++d) norm += out[d] * out[d];
+        if (norm > 0) {
+            float scale = 1.5f / std::sqrt(norm);
+            for (size_t d = 0; d < dims; ++d) out[d] *= scale;
+        }
+    }
+
+    uint32_t signature(const float* v, size_t table) const {
+        uint32_t sig = 0;
+        for (size_t b = 0; b < LSH_BITS; ++b)
+            if (dot(v, &planes[(table * LSH_BITS + b) * DIMS]) >= 0) sig |= 1u << b;
+        return sig;
+    }
+
+    // Random-projection LSH: similar vectors fall on the same side of most
+    // hyperplanes, so they tend to share a bucket in at least one table
+    void buildLsh() {
+        std::mt19937 rng(25);
+        std::normal_distribution<float> gauss;
+        planes.resize(LSH_TABLES * LSH_BITS * DIMS);
+        for (float& p : planes) p = gauss(rng);
+        lsh.assign(LSH_TABLES, {});
+        for (size_t row = 0; row < rows; ++row) {
+            if (!listed[row]) continue;
+            for (size_t t = 0; t < LSH_TABLES; ++t)
+                lsh[t][signature(&features[row * DIMS], t)].push_back((uint32_t)row);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "game_table.h"
+#include "utils.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+// Page size to use when none was given: a screenful on a terminal, and
+// everything at once when the output is piped or redirected
+inline size_t defaultPageSize() {
+#if defined(__unix__) || defined(__APPLE__)
+    return isatty(STDOUT_FILENO) ? 20 : 0;
+#else
+    return 20;
+#endif
+}
+
+// Prints result rows through one big buffer instead of a stream insert
+// per field. Rows are only formatted when they are about to be shown:
+// with paging on, a query with a million matches formats one page.
+// Page size 0 streams every row with no prompts, for piping.
+class ResultWriter {
+public:
+    static const size_t BUFFER_BYTES = 1 << 20;
+
+    ResultWriter(std::ostream& o, size_t pageRows = 0) : out(o), pageSize(pageRows) {
+        buf.reserve(BUFFER_BYTES + 4096);
+    }
+    ~ResultWriter() { flush(); }
+
+    size_t page() const { return pageSize; }
+
+    void put(std::string_view s) {
+        buf.append(s.data(), s.size());
+        if (buf.size() >= BUFFER_BYTES) flush();
+    }
+
+    void putRow(const GameTable& table, size_t row) {
+        table.appendRow(buf, row);
+        buf += '\n';
+        if (buf.size() >= BUFFER_BYTES) flush();
+    }
+
+    void flush() {
+        if (buf.empty()) return;
+        out.write(buf.data(), (std::streamsize)buf.size());
+        buf.clear();
+        out.flush();
+    }
+
+    // Show count rows, where rowAt(k) gives the table row of the k-th result.
+    // Numbered lists prefix "k) " so a later prompt can refer to them.
+    // When paging, `in` is read for n(ext) / p(rev) / q(uit) between pages.
+    template <class RowAt>
+    void show(const GameTable& table, size_t count, RowAt rowAt, std::istream& in, bool numbered = false) {
+        size_t per = pageSize ? pageSize : count;
+        size_t first = 0;
+        while (first < count) {
+            size_t last = std::min(count, first + per);
+            for (size_t k = first; k < last; ++k) {
+                if (numbered) { put(std::to_string(k + 1)); put(") "); }
+                putRow(table, rowAt(k));
+            }
+            if (last == count && first == 0) break;
+
+            put("-- ");
+            put(std::to_string(first + 1) + "-" + std::to_string(last) + " of " + std::to_string(count));
+            put(" -- n)ext, p)rev, q)uit: ");
+            flush();
+            std::string cmd;
+            if (!std::getline(in, cmd)) break;
+            cmd = toLower(trim(cmd));
+            if (cmd == "q") break;
+            if (cmd == "p") first = first >= per ? first - per : 0;
+            else if (last < count) first = last;
+            else break;
+        }
+        flush();
+    }
+
+private:
+    std::ostream& out;
+    size_t pageSize;
+    std::string buf;
+};
+
+#endif
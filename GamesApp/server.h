@@ -0,0 +1,328 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "batch.h"
+#include "dataset.h"
+#include "favorites.h"
+#include "metrics.h"
+#include "protocol.h"
+#include "stats.h"
+#include "user_store.h"
+
+#ifdef GAMES_HAVE_SOCKETS
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/time.h>
+
+// Serves many clients from one loaded copy of the dataset.
+//
+// One I/O thread polls the listening socket and every idle connection.
+// When a full request line arrives, the line goes to a fixed pool of
+// workers, and that connection isn't polled again until its reply has
+// been written, so replies come back in request order. Workers only read
+// the shared Dataset, which is immutable, so queries need no locks.
+//
+// Requests: everything batch mode takes (search, fuzzy, best, rating, top),
+// plus
+//   signup <user> <password>     login <user> <password>
+//   favorites                    favorite add|remove <rank>
+//   stats                        quit
+//   stats ops                    operation timings (with --metrics)
+// Per connection there is just the input buffer and, after login, a
+// pointer to that user's state. Two sessions for the same user share it.
+class GamesServer {
+public:
+    GamesServer(DatasetWatcher& w, UserStore& u, unsigned threads)
+        : watcher(w), users(u), workerCount(threads ? threads : 1) {}
+
+    ~GamesServer() { stop(); }
+
+    // Serve on `path` until stop() is called. False if the socket can't be set up.
+    bool run(const std::string& path) {
+        sockaddr_un addr;
+        if (!fillSocketAddress(path, addr)) return false;
+        std::signal(SIGPIPE, SIG_IGN);   // a client hanging up mid-reply is not fatal
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0) return false;
+        ::unlink(path.c_str());
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listenFd, 128) != 0 || ::pipe(wakePipe) != 0) {
+            ::close(listenFd);
+            return false;
+        }
+        setNonBlocking(listenFd);
+        setNonBlocking(wakePipe[0]);
+
+        stopping = false;
+        for (unsigned t = 0; t < workerCount; ++t) workers.emplace_back([this] { workLoop(); });
+        ioLoop();
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            workersDone = true;
+        }
+        queueReady.notify_all();
+        for (auto& t : workers) t.join();
+        workers.clear();
+        for (auto& c : connections) ::close(c.first);
+        connections.clear();
+        ::close(listenFd);
+        ::close(wakePipe[0]);
+        ::close(wakePipe[1]);
+        ::unlink(path.c_str());
+        return true;
+    }
+
+    // Safe to call from a signal handler
+    void stop() { stopping = true; }
+
+private:
+    // Everything a logged-in user has on the server
+    struct UserState {
+        std::mutex mutex;
+        FavoritesStore favorites;
+        uint64_t version = 0;   // dataset version favorites are bound to
+    };
+
+    struct Connection {
+        int fd = -1;
+        std::string input;
+        bool busy = false;     // a worker owns it until the reply is out
+        bool closing = false;
+        std::shared_ptr<UserState> user;
+    };
+
+    struct Job {
+        Connection* conn;
+        std::string line;
+    };
+
+    static const size_t MAX_LINE = 64 * 1024;
+    static const int CLIENT_TIMEOUT_SECONDS = 10;   // per send/recv on a client socket
+
+    DatasetWatcher& watcher;
+    UserStore& users;
+    unsigned workerCount;
+    std::atomic<bool> stopping{false};
+    int listenFd = -1;
+    int wakePipe[2] = {-1, -1};
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;   // I/O thread only
+
+    std::vector<std::thread> workers;
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<Job> jobs;
+    bool workersDone = false;
+    std::mutex doneMutex;
+    std::vector<int> finished;   // connections whose reply has been written
+
+    std::mutex usersMutex;       // guards users and sessions
+    std::unordered_map<std::string, std::weak_ptr<UserState>> sessions;
+
+    std::mutex statsMutex;
+    StatsEngine statsEngine;
+    uint64_t statsVersion = 0;
+
+    static void setNonBlocking(int fd) { ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+    // Workers write replies with blocking sends, so a client that stops
+    // reading would otherwise hold a worker forever. A timed-out send
+    // fails, and the connection is closed once the worker gives it back
+    static void setTimeouts(int fd) {
+        timeval tv{CLIENT_TIMEOUT_SECONDS, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    void ioLoop() {
+        std::vector<pollfd> fds;
+        while (!stopping) {
+            fds.clear();
+            fds.push_back({listenFd, POLLIN, 0});
+            fds.push_back({wakePipe[0], POLLIN, 0});
+            for (auto& c : connections)
+                if (!c.second->busy) fds.push_back({c.first, POLLIN, 0});
+            if (::poll(fds.data(), fds.size(), 200) <= 0) continue;
+
+            if (fds[0].revents & POLLIN) {
+                int fd;
+                while ((fd = ::accept(listenFd, nullptr, nullptr)) >= 0) {
+                    setTimeouts(fd);
+                    auto c = std::make_unique<Connection>();
+                    c->fd = fd;
+                    connections.emplace(fd, std::move(c));
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                char drain[256];
+                while (::read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+                std::vector<int> done;
+                {
+                    std::lock_guard<std::mutex> lock(doneMutex);
+                    done.swap(finished);
+                }
+                for (int fd : done) {
+                    auto it = connections.find(fd);
+                    if (it == connections.end()) continue;
+                    it->second->busy = false;
+                    if (it->second->closing) drop(fd);
+                    else dispatch(*it->second);
+                }
+            }
+            for (size_t k = 2; k < fds.size(); ++k) {
+                if (!fds[k].revents) continue;
+                auto it = connections.find(fds[k].fd);
+                if (it == connections.end()) continue;
+                char buf[16384];
+                ssize_t n = ::recv(fds[k].fd, buf, sizeof(buf), 0);
+                if (n <= 0) { drop(fds[k].fd); continue; }
+                it->second->input.append(buf, (size_t)n);
+                if (it->second->input.size() > MAX_LINE && it->second->input.find('\n') == std::string::npos) {
+                    drop(fds[k].fd);
+                    continue;
+                }
+                dispatch(*it->second);
+            }
+        }
+    }
+
+    void drop(int fd) {
+        ::close(fd);
+        connections.erase(fd);
+    }
+
+    // Hand the next buffered request on this connection to the workers
+    void dispatch(Connection& c) {
+        if (c.busy) return;
+        size_t nl = c.input.find('\n');
+        if (nl == std::string::npos) return;
+        std::string line = c.input.substr(0, nl);
+        c.input.erase(0, nl + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        c.busy = true;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            jobs.push_back({&c, std::move(line)});
+        }
+        queueReady.notify_one();
+    }
+
+    void workLoop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueReady.wait(lock, [&] { return workersDone || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            std::string reply = handle(*job.conn, job.line);
+            if (!writeAll(job.conn->fd, reply.data(), reply.size())) job.conn->closing = true;
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                finished.push_back(job.conn->fd);
+            }
+            char one = 1;
+            (void)!::write(wakePipe[1], &one, 1);
+        }
+    }
+
+    std::string handle(Connection& c, const std::string& line) {
+        std::shared_ptr<const Dataset> data = watcher.current();
+        std::istringstream words(line);
+        std::string verb;
+        words >> verb;
+        verb = toLower(verb);
+
+        if (verb == "quit") {
+            c.closing = true;
+            return okReply("");
+        }
+        if (verb == "login" || verb == "signup") {
+            std::string name, password;
+            words >> name >> password;
+            if (name.empty()) return errorReply("expected " + verb + " <user> <password>");
+            std::lock_guard<std::mutex> lock(usersMutex);
+            ScopedOp timed(OP_LOGIN);
+            if (verb == "signup") {
+                AddUserResult added = users.add(name, password);
+                if (added == USER_TAKEN) return errorReply("username taken");
+                if (added == USER_IO_ERROR) return errorReply("can't save account");
+            }
+            if (!users.checkPassword(name, password)) return errorReply("incorrect username or password");
+            std::shared_ptr<UserState> state = sessions[name].lock();
+            if (!state) {
+                state = std::make_shared<UserState>();
+                state->favorites.open("favorites_" + name + ".csv", data->table);
+                state->version = data->version;
+                sessions[name] = state;
+            }
+            c.user = std::move(state);
+            return okReply("");
+        }
+        if (verb == "favorites" || verb == "favorite") {
+            if (!c.user) return errorReply("login first");
+            UserState& u = *c.user;
+            std::lock_guard<std::mutex> lock(u.mutex);
+            if (u.version != data->version) {
+                u.favorites.rebind(data->table);
+                u.version = data->version;
+            }
+            ScopedOp timed(verb == "favorites" ? OP_FAVORITES_READ : OP_FAVORITES_WRITE);
+            std::string body;
+            if (verb == "favorites") {
+                for (size_t row : u.favorites.rows()) { data->table.appendRow(body, row); body += '\n'; }
+                return okReply(body);
+            }
+            std::string action;
+            long rank = 0;
+            size_t row = 0;
+            if (!(words >> action >> rank) || (action != "add" && action != "remove"))
+                return errorReply("expected favorite add|remove <rank>");
+            if (!u.favorites.rowOf((int32_t)rank, row)) return errorReply("no game with rank " + std::to_string(rank));
+            bool changed = action == "add" ? u.favorites.add(row) : u.favorites.remove(row);
+            return okReply(changed ? "changed\n" : "unchanged\n");
+        }
+        if (verb == "stats") {
+            std::ostringstream out;
+            std::string what;
+            if (words >> what && toLower(what) == "ops") {
+                metrics::print(out);
+                return okReply(out.str());
+            }
+            ScopedOp timed(OP_STATISTICS);
+            std::lock_guard<std::mutex> lock(statsMutex);
+            if (statsVersion != data->version) {
+                statsEngine = StatsEngine();
+                statsVersion = data->version;
+            }
+            StatsEngine::print(out, statsEngine.get(data->table));
+            return okReply(out.str());
+        }
+
+        BatchRunner runner(data->table, data->names, data->ratings, data->tops, data->relevance);
+        std::vector<size_t> rows;
+        std::string error;
+        if (!runner.execute(line, rows, error)) return errorReply(error);
+        std::string body;
+        for (size_t row : rows) { data->table.appendRow(body, row); body += '\n'; }
+        return okReply(body);
+    }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "game_table.h"
+#include "mapped_file.h"
+#include "metrics.h"
+#include "name_index.h"
+#include "rating_index.h"
+
+// Fast 64-bit hash for whole files: four independent multiply-xor lanes
+// over 8-byte words, so it runs at memory speed. Not cryptographic.
+inline uint64_t hashBytes(const char* p, size_t n) {
+    const uint64_t K = 0x9E3779B97F4A7C15ull;
+    uint64_t h[4] = {K, K * 3, K * 5, K * 7};
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int k = 0; k < 4; ++k) {
+            uint64_t w;
+            std::memcpy(&w, p + i + 8 * k, 8);
+            h[k] = (h[k] ^ w) * K;
+            h[k] ^= h[k] >> 29;
+        }
+    }
+    for (; i < n; ++i) h[i & 3] = (h[i & 3] ^ (unsigned char)p[i]) * K;
+    uint64_t out = n;
+    for (int k = 0; k < 4; ++k) {
+        out = (out ^ h[k]) * K;
+        out ^= out >> 32;
+    }
+    return out;
+}
+
+// What a snapshot was built from. Any difference means the CSV changed.
+struct SnapshotKey {
+    uint64_t csvBytes = 0;
+    int64_t csvMtime = 0;
+    uint64_t csvHash = 0;
+
+    bool operator==(const SnapshotKey& o) const {
+        return csvBytes == o.csvBytes && csvMtime == o.csvMtime && csvHash == o.csvHash;
+    }
+};
+
+// Key for the CSV mapped in `csv`, hashed from that same mapping so the
+// key always describes the bytes that get parsed
+inline SnapshotKey snapshotKeyFor(const std::string& csvPath, const MappedFile& csv) {
+    SnapshotKey key;
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(csvPath, ec);
+    key.csvBytes = csv.size();
+    key.csvMtime = ec ? 0 : (int64_t)mtime.time_since_epoch().count();
+    key.csvHash = hashBytes(csv.data(), csv.size());
+    return key;
+}
+
+// Snapshot layout: a fixed header, then named sections each aligned to 64
+// bytes, then a table of contents. The checksum covers everything after
+// the header. Bump SNAPSHOT_VERSION whenever any saveTo() changes shape.
+const uint32_t SNAPSHOT_VERSION = 3;
+
+struct SnapshotHeader {
+    char magic[8];            // "GSNAPSHT"
+    uint32_t version;
+    uint32_t byteOrder;       // 0x01020304 as written by the saving machine
+    SnapshotKey key;
+    uint64_t tocOffset;
+    uint64_t tocCount;
+    uint64_t checksum;
+};
+
+struct SnapshotSection {
+    char name[16];
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::ofstream& o) : out(o) {}
+
+    void putBytes(const char* name, const void* p, size_t bytes) {
+        pad();
+        SnapshotSection s{};
+        std::memcpy(s.name, name, std::min(std::strlen(name), sizeof(s.name) - 1));
+        s.offset = (uint64_t)out.tellp();
+        s.bytes = bytes;
+        out.write(static_cast<const char*>(p), (std::streamsize)bytes);
+        toc.push_back(s);
+    }
+
+    template <class T>
+    void put(const char* name, const std::vector<T>& v) {
+        putBytes(name, v.data(), v.size() * sizeof(T));
+    }
+
+    // Table of contents goes last; returns its offset
+    uint64_t finish() {
+        pad();
+        uint64_t at = (uint64_t)out.tellp();
+        out.write(reinterpret_cast<const char*>(toc.data()), (std::streamsize)(toc.size() * sizeof(SnapshotSection)));
+        return at;
+    }
+
+    size_t sections() const { return toc.size(); }
+
+private:
+    std::ofstream& out;
+    std::vector<SnapshotSection> toc;
+
+    void pad() {
+        static const char zeros[64] = {0};
+        uint64_t at = (uint64_t)out.tellp();
+        if (at % 64) out.write(zeros, (std::streamsize)(64 - at % 64));
+    }
+};
+
+class SnapshotReader {
+public:
+    // Map the snapshot and check it's intact and was built from `key`
+    bool open(const std::string& path, const SnapshotKey& key) {
+        auto f = std::make_shared<MappedFile>();
+        if (!f->open(path) || f->size() < sizeof(SnapshotHeader)) return false;
+        SnapshotHeader h;
+        std::memcpy(&h, f->data(), sizeof(h));
+        if (std::memcmp(h.magic, "GSNAPSHT", 8) != 0 || h.version != SNAPSHOT_VERSION ||
+            h.byteOrder != 0x01020304u || !(h.key == key))
+            return false;
+        if (h.tocOffset > f->size() || h.tocCount > (f->size() - h.tocOffset) / sizeof(SnapshotSection))
+            return false;
+        if (hashBytes(f->data() + sizeof(h), f->size() - sizeof(h)) != h.checksum) return false;
+        f->endSequentialScan();   // names are read from it in place, by row
+
+        toc.resize((size_t)h.tocCount);
+        std::memcpy(toc.data(), f->data() + h.tocOffset, toc.size() * sizeof(SnapshotSection));
+        for (const SnapshotSection& s : toc)
+            if (s.offset > f->size() || s.bytes > f->size() - s.offset) return false;
+        file_ = std::move(f);
+        return true;
+    }
+
+    bool find(const char* name, uint64_t& offset, uint64_t& bytes) const {
+        for (const SnapshotSection& s : toc) {
+            if (std::strncmp(s.name, name, sizeof(s.name)) == 0) {
+                offset = s.offset;
+                bytes = s.bytes;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <class T>
+    bool get(const char* name, std::vector<T>& out) const {
+        uint64_t offset, bytes;
+        if (!find(name, offset, bytes) || bytes % sizeof(T) != 0) return false;
+        out.resize((size_t)(bytes / sizeof(T)));
+        if (bytes) std::memcpy(out.data(), file_->data() + offset, (size_t)bytes);
+        return true;
+    }
+
+    // The mapping sections live in, for data that is used in place
+    std::shared_ptr<const MappedFile> file() const { return file_; }
+
+private:
+    std::shared_ptr<const MappedFile> file_;
+    std::vector<SnapshotSection> toc;
+};
+
+// Write a snapshot file whose sections come from fill(SnapshotWriter&).
+// Goes through a temp file and a rename, so readers only ever see a whole
+// snapshot.
+template <class Fill>
+inline bool writeSnapshotFile(const std::string& path, const SnapshotKey& key, Fill&& fill) {
+    std::string tmp = path + ".tmp";
+    SnapshotHeader h{};
+    std::memcpy(h.magic, "GSNAPSHT", 8);
+    h.version = SNAPSHOT_VERSION;
+    h.byteOrder = 0x01020304u;
+    h.key = key;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        SnapshotWriter w(out);
+        fill(w);
+        h.tocCount = w.sections();
+        h.tocOffset = w.finish();
+        if (!out) { std::remove(tmp.c_str()); return false; }
+    }
+    {
+        MappedFile written;
+        if (!written.open(tmp)) { std::remove(tmp.c_str()); return false; }
+        h.checksum = hashBytes(written.data() + sizeof(h), written.size() - sizeof(h));
+    }
+    {
+        std::fstream out(tmp, std::ios::binary | std::ios::in | std::ios::out);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        if (!out) { std::remove(tmp.c_str()); return false; }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) { std::remove(tmp.c_str()); return false; }
+    return true;
+}
+
+// Write table + indexes to `path`
+inline bool saveSnapshot(const std::string& path, const SnapshotKey& key, const std::string& header,
+                         const GameTable& table, const NameIndex& names, const RatingIndex& ratings) {
+    return writeSnapshotFile(path, key, [&](SnapshotWriter& w) {
+        w.putBytes("header", header.data(), header.size());
+        table.saveTo(w);
+        names.saveTo(w);
+        ratings.saveTo(w);
+    });
+}
+
+inline bool loadSnapshot(const std::string& path, const SnapshotKey& key, std::string& header,
+                         GameTable& table, NameIndex& names, RatingIndex& ratings) {
+    // Decode everything into locals first, so a bad section leaves the
+    // caller's table and indexes as they were
+    SnapshotReader r;
+    if (!r.open(path, key)) return false;
+    std::vector<char> h;
+    if (!r.get("header", h)) return false;
+    GameTable t;
+    NameIndex n;
+    RatingIndex rt;
+    // The name index keeps a pointer to its table, so bind it to `table`,
+    // which is where t ends up
+    if (!t.loadFrom(r) || !n.loadFrom(r, table) || !rt.loadFrom(r) || n.size() != t.size()) return false;
+    table = std::move(t);
+    names = std::move(n);
+    ratings = std::move(rt);
+    header.assign(h.begin(), h.end());
+    return true;
+}
+
+// loadGameTable plus the name and rating indexes, served from
+// <csv>.snap when it was built from this exact CSV. Otherwise the CSV is
+// parsed, the indexes built, and a fresh snapshot written for next time.
+inline bool loadGamesCached(const std::string& csvPath, GameTable& table, std::string& header,
+                            NameIndex& names, RatingIndex& ratings) {
+    std::string snapPath = csvPath + ".snap";
+    auto csv = std::make_shared<MappedFile>();
+    if (!csv->open(csvPath)) return false;
+    SnapshotKey key = snapshotKeyFor(csvPath, *csv);
+    if (loadSnapshot(snapPath, key, header, table, names, ratings)) {
+        metrics::addRows(table.size());
+        return true;
+    }
+
+    if (!loadGameTable(std::move(csv), table, header)) return false;
+    names.build(table);
+    ratings.build(table);
+    // Switch over to the snapshot we just wrote, so names stop pointing
+    // into the CSV and the CSV can be rewritten while we still run. With
+    // no snapshot the names are copied instead; a CSV truncated in place
+    // under a live mapping would fault on the next name read
+    if (!saveSnapshot(snapPath, key, header, table, names, ratings) ||
+        !loadSnapshot(snapPath, key, header, table, names, ratings))
+        table.detachNames();
+    metrics::addRows(table.size());
+    return true;
+}
+
+#endif
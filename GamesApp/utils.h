@@ -4,35 +4,17 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include "case_fold.h"
+#include "csv.h"
 
-// Simple CSV line parser (handles quoted commas)
+// CSV line parser (RFC 4180: quoted commas, "" escapes)
 inline std::vector<std::string> splitCSVLine(const std::string& line) {
-    std::vector<std::string> cols;
-    std::string cur;
-    bool inQuotes = false;
-
-    for (char c : line) {
-        if (c == '"') {
-            inQuotes = !inQuotes;
-            continue;
-        }
-        if (c == ',' && !inQuotes) {
-            cols.push_back(cur);
-            cur.clear();
-        } else {
-            cur.push_back(c);
-        }
-    }
-    cols.push_back(cur);
-    return cols;
+    return splitCSVFields(line);
 }
 
-// Convert string to lowercase
+// Convert string to lowercase (UTF-8 aware, see case_fold.h)
 inline std::string toLower(const std::string& s) {
-    std::string result = s;
-    std::transform(result.begin(), result.end(),
-                   result.begin(), ::tolower);
-    return result;
+    return foldCase(s);
 }
 
 // Trim whitespace